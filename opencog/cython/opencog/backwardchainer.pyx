@@ -2,7 +2,7 @@ from cython.operator cimport dereference as deref
 from opencog.atomspace cimport Atom
 from opencog.atomspace cimport cHandle, AtomSpace, TruthValue
 from opencog.atomspace import types
-from ure cimport cBackwardChainer
+from ure cimport cUREConfig, cBackwardChainer
 
 # Create a Cython extension type which holds a C++ instance
 # as an attribute and create a bunch of forwarding methods
@@ -43,6 +43,21 @@ cdef class BackwardChainer:
         self._trace_as = trace_as
         self._control_as = control_as
 
+    def set_budget(self, wall_time=None, cpu_time=None,
+                   pm_executions=None, produced_atoms=None):
+        """Limit the resources of the next do_chain call. Times are in
+        seconds, negative values mean unlimited, None leaves the
+        corresponding limit unchanged."""
+        cdef cUREConfig* config = &self.chainer.get_config()
+        if wall_time is not None:
+            config.set_maximum_wall_time(wall_time)
+        if cpu_time is not None:
+            config.set_maximum_cpu_time(cpu_time)
+        if pm_executions is not None:
+            config.set_maximum_pm_executions(pm_executions)
+        if produced_atoms is not None:
+            config.set_maximum_produced_atoms(produced_atoms)
+
     def do_chain(self):
         return self.chainer.do_chain()
 
@@ -1,7 +1,7 @@
 from opencog.atomspace import types
 from cython.operator cimport dereference as deref, preincrement as inc
 from opencog.atomspace cimport cHandle, Atom, AtomSpace, TruthValue
-from ure cimport cForwardChainer
+from ure cimport cUREConfig, cForwardChainer
 
 # Create a Cython extension type which holds a C++ instance
 # as an attribute and create a bunch of forwarding methods
@@ -39,6 +39,21 @@ cdef class ForwardChainer:
         self._as = _as
         self._trace_as = trace_as
 
+    def set_budget(self, wall_time=None, cpu_time=None,
+                   pm_executions=None, produced_atoms=None):
+        """Limit the resources of the next do_chain call. Times are in
+        seconds, negative values mean unlimited, None leaves the
+        corresponding limit unchanged."""
+        cdef cUREConfig* config = &self.chainer.get_config()
+        if wall_time is not None:
+            config.set_maximum_wall_time(wall_time)
+        if cpu_time is not None:
+            config.set_maximum_cpu_time(cpu_time)
+        if pm_executions is not None:
+            config.set_maximum_pm_executions(pm_executions)
+        if produced_atoms is not None:
+            config.set_maximum_produced_atoms(produced_atoms)
+
     def do_chain(self):
         return self.chainer.do_chain()
 
@@ -4,6 +4,14 @@ from opencog.atomspace cimport cHandle, cAtomSpace
 from opencog.logger cimport cLogger
 
 
+cdef extern from "opencog/ure/UREConfig.h" namespace "opencog":
+    cdef cppclass cUREConfig "opencog::UREConfig":
+        void set_maximum_wall_time(double)
+        void set_maximum_cpu_time(double)
+        void set_maximum_pm_executions(int)
+        void set_maximum_produced_atoms(int)
+
+
 cdef extern from "opencog/ure/forwardchainer/ForwardChainer.h" namespace "opencog":
     cdef cppclass cForwardChainer "opencog::ForwardChainer":
         cForwardChainer(cAtomSpace& kb_as,
@@ -14,6 +22,7 @@ cdef extern from "opencog/ure/forwardchainer/ForwardChainer.h" namespace "openco
                         cAtomSpace* trace_as,
                         const vector[cHandle]& focus_set) except +
 
+        cUREConfig& get_config()
         void do_chain() except +
         cHandle get_results() const
 
@@ -68,6 +77,7 @@ cdef extern from "opencog/ure/backwardchainer/BackwardChainer.h" namespace "open
                         cAtomSpace* control_as,
                         const cHandle& focus_set) except +
 
+        cUREConfig& get_config()
         void do_chain() except +
         cHandle get_results() const
 
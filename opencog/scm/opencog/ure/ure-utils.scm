@@ -23,16 +23,32 @@
 ;; -- ure-search-rules -- Retrieve all potential rules
 ;; -- ure-set-num-parameter -- Set a numeric parameter of an rbs
 ;; -- ure-set-fuzzy-bool-parameter -- Set a fuzzy boolean parameter of an rbs
+;; -- ure-set-concept-parameter -- Set a concept parameter of an rbs
 ;; -- ure-set-attention-allocation -- Set the URE:attention-allocation parameter
 ;; -- ure-set-maximum-iterations -- Set the URE:maximum-iterations parameter
 ;; -- ure-set-complexity-penalty -- Set the URE:complexity-penalty parameter
 ;; -- ure-set-jobs -- Set the URE:jobs parameter
 ;; -- ure-set-expansion-pool-size -- Set the URE:expansion-pool-size parameter
+;; -- ure-set-maximum-wall-time -- Set the URE:maximum-wall-time parameter
+;; -- ure-set-maximum-cpu-time -- Set the URE:maximum-cpu-time parameter
+;; -- ure-set-maximum-pm-executions -- Set the URE:maximum-pm-executions parameter
+;; -- ure-set-maximum-produced-atoms -- Set the URE:maximum-produced-atoms parameter
+;; -- ure-set-random-seed -- Set the URE:random-seed parameter
 ;; -- ure-set-fc-retry-exhausted-sources -- Set the URE:FC:retry-exhausted-sources parameter
 ;; -- ure-set-fc-full-rule-application -- Set the URE:FC:full-rule-application parameter
+;; -- ure-set-fc-semi-naive -- Set the URE:FC:semi-naive parameter
+;; -- ure-set-fc-match-network -- Set the URE:FC:match-network parameter
+;; -- ure-set-fc-source-selection-mode -- Set the URE:FC:source-selection-mode parameter
+;; -- ure-set-fc-source-rule-selection-mode -- Set the URE:FC:source-rule-selection-mode parameter
+;; -- ure-set-fc-tournament-size -- Set the URE:FC:tournament-size parameter
+;; -- ure-set-fc-batch-size -- Set the URE:FC:batch-size parameter
+;; -- ure-set-fc-inference-log-size -- Set the URE:FC:inference-log-size parameter
+;; -- ure-set-fc-maximum-sources -- Set the URE:FC:maximum-sources parameter
 ;; -- ure-set-bc-maximum-bit-size -- Set the URE:BC:maximum-bit-size
 ;; -- ure-set-bc-mm-complexity-penalty -- Set the URE:BC:MM:complexity-penalty
 ;; -- ure-set-bc-mm-compressiveness -- Set the URE:BC:MM:compressiveness
+;; -- ure-set-bc-asynchronous-fulfillment -- Set the
+;;                      URE:BC:asynchronous-fulfillment parameter
 ;; -- ure-define-rbs -- Create a rbs that runs for a particular number of
 ;;                      iterations.
 ;; -- ure-logger-set-level! -- Set level of the URE logger
@@ -94,8 +110,21 @@
                  (complexity-penalty *unspecified*)
                  (jobs *unspecified*)
                  (expansion-pool-size *unspecified*)
+                 (maximum-wall-time *unspecified*)
+                 (maximum-cpu-time *unspecified*)
+                 (maximum-pm-executions *unspecified*)
+                 (maximum-produced-atoms *unspecified*)
+                 (random-seed *unspecified*)
                  (fc-retry-exhausted-sources *unspecified*)
-                 (fc-full-rule-application *unspecified*))
+                 (fc-full-rule-application *unspecified*)
+                 (fc-semi-naive *unspecified*)
+                 (fc-match-network *unspecified*)
+                 (fc-source-selection-mode *unspecified*)
+                 (fc-source-rule-selection-mode *unspecified*)
+                 (fc-tournament-size *unspecified*)
+                 (fc-batch-size *unspecified*)
+                 (fc-inference-log-size *unspecified*)
+                 (fc-maximum-sources *unspecified*))
 "
   Forward Chainer call.
 
@@ -108,8 +137,21 @@
                  #:complexity-penalty cp
                  #:jobs jb
                  #:expansion-pool-size esp
+                 #:maximum-wall-time mwt
+                 #:maximum-cpu-time mct
+                 #:maximum-pm-executions mpe
+                 #:maximum-produced-atoms mpa
+                 #:random-seed rs
                  #:fc-retry-exhausted-sources res
-                 #:fc-full-rule-application fra)
+                 #:fc-full-rule-application fra
+                 #:fc-semi-naive sn
+                 #:fc-match-network mn
+                 #:fc-source-selection-mode ssm
+                 #:fc-source-rule-selection-mode srsm
+                 #:fc-tournament-size ts
+                 #:fc-batch-size bs
+                 #:fc-inference-log-size ils
+                 #:fc-maximum-sources ms)
 
   rbs: ConceptNode representing a rulebase.
 
@@ -143,6 +185,23 @@
        the forward chainer), but also then the selection is more costly.
        Negative or null means unlimited (not recommended).
 
+  mwt: [optional, default=-1] Maximum wall time in seconds. When
+       reached, chaining stops and the results found so far are
+       returned. Negative means unlimited.
+
+  mct: [optional, default=-1] Maximum CPU time in seconds, of the whole
+       process. Negative means unlimited.
+
+  mpe: [optional, default=-1] Maximum number of pattern matcher
+       executions. Negative means unlimited.
+
+  mpa: [optional, default=-1] Maximum number of atoms produced by rule
+       applications, duplicates included. Negative means unlimited.
+
+  rs: [optional, default=-1] Seed of the random draws of the chainer.
+      With a given seed and a single job, chaining is reproducible.
+      Negative means drawn from the global random generator.
+
   res: [optional, default=#f] Whether exhausted sources should be
        retried. A source is exhausted if all its valid rules (so that at
        least one rule premise unifies with the source) have been applied to
@@ -154,6 +213,49 @@
        entire atomspace, not just the source. This can be convienient if
        the goal is to rapidly achieve inference closure.
 
+  sn: [optional, default=#f] Whether rules applied over the entire
+      atomspace (see fra) only consider groundings where at least one
+      premise is an atom produced since the last application of that
+      rule. This avoids rediscovering previous conclusions, so that the
+      cost of reaching inference closure depends on the number of new
+      facts rather than the size of the atomspace. Atoms added to the
+      atomspace by other means during forward chaining are not
+      considered new.
+
+  mn: [optional, default=#f] Whether source rule pairs are produced
+      incrementally as new sources are produced, by an alpha network
+      prefiltering the rules by type and arity of their premises,
+      rather than by selecting sources and unifying them with all rules.
+
+  ssm: [optional, default=\"tv-fitness\"] How the next source to expand
+       is selected. Either \"tv-fitness\" (proportionally to its weight),
+       \"tournament\" (the heaviest of ts sources drawn uniformly) or
+       \"uniform\".
+
+  srsm: [optional, default=\"thompson\"] How the next source rule pair
+        to apply is selected from the expansion pool. Either \"thompson\"
+        (Thompson sampling), \"tv-fitness\" (proportionally to its
+        probability of success), \"tournament\" (the most likely to
+        succeed of ts pairs drawn uniformly) or \"uniform\". The last
+        three are cheaper but less accurate than Thompson sampling.
+
+  ts: [optional, default=2] Tournament size used by the tournament
+      selection modes.
+
+  bs: [optional, default=1] Maximum number of source rule pairs of the
+      expansion pool sharing the same rule that are applied together in
+      one iteration. Larger values amortize the cost of rule application
+      over many sources, at the expense of selection accuracy.
+
+  ils: [optional, default=-1] Maximum number of inference records
+       retained in memory per thread, the oldest being discarded first.
+       Results are not affected. Negative means unlimited.
+
+  ms: [optional, default=-1] Maximum number of sources in the
+      population. When exceeded, the sources least likely to be
+      selected (exhausted first, then by weight and complexity) are
+      evicted and never reinserted. Negative means unlimited.
+
   Note that the defaults of the optional arguments are not determined
   here (although they attempt to be documented here).  That is the case
   in order not to overwrite existing parameters set by
@@ -172,10 +274,36 @@
       (ure-set-jobs rbs jobs))
   (if (not (unspecified? expansion-pool-size))
       (ure-set-expansion-pool-size rbs expansion-pool-size))
+  (if (not (unspecified? maximum-wall-time))
+      (ure-set-maximum-wall-time rbs maximum-wall-time))
+  (if (not (unspecified? maximum-cpu-time))
+      (ure-set-maximum-cpu-time rbs maximum-cpu-time))
+  (if (not (unspecified? maximum-pm-executions))
+      (ure-set-maximum-pm-executions rbs maximum-pm-executions))
+  (if (not (unspecified? maximum-produced-atoms))
+      (ure-set-maximum-produced-atoms rbs maximum-produced-atoms))
+  (if (not (unspecified? random-seed))
+      (ure-set-random-seed rbs random-seed))
   (if (not (unspecified? fc-retry-exhausted-sources))
       (ure-set-fc-retry-exhausted-sources rbs fc-retry-exhausted-sources))
   (if (not (unspecified? fc-full-rule-application))
       (ure-set-fc-full-rule-application rbs fc-full-rule-application))
+  (if (not (unspecified? fc-semi-naive))
+      (ure-set-fc-semi-naive rbs fc-semi-naive))
+  (if (not (unspecified? fc-match-network))
+      (ure-set-fc-match-network rbs fc-match-network))
+  (if (not (unspecified? fc-source-selection-mode))
+      (ure-set-fc-source-selection-mode rbs fc-source-selection-mode))
+  (if (not (unspecified? fc-source-rule-selection-mode))
+      (ure-set-fc-source-rule-selection-mode rbs fc-source-rule-selection-mode))
+  (if (not (unspecified? fc-tournament-size))
+      (ure-set-fc-tournament-size rbs fc-tournament-size))
+  (if (not (unspecified? fc-batch-size))
+      (ure-set-fc-batch-size rbs fc-batch-size))
+  (if (not (unspecified? fc-inference-log-size))
+      (ure-set-fc-inference-log-size rbs fc-inference-log-size))
+  (if (not (unspecified? fc-maximum-sources))
+      (ure-set-fc-maximum-sources rbs fc-maximum-sources))
 
   ;; Defined optional atomspaces and call the forward chainer
   (let* ((trace-enabled (cog-atomspace? trace-as))
@@ -193,9 +321,15 @@
                  (complexity-penalty *unspecified*)
                  (jobs *unspecified*)
                  (expansion-pool-size *unspecified*)
+                 (maximum-wall-time *unspecified*)
+                 (maximum-cpu-time *unspecified*)
+                 (maximum-pm-executions *unspecified*)
+                 (maximum-produced-atoms *unspecified*)
+                 (random-seed *unspecified*)
                  (bc-maximum-bit-size *unspecified*)
                  (bc-mm-complexity-penalty *unspecified*)
-                 (bc-mm-compressiveness *unspecified*))
+                 (bc-mm-compressiveness *unspecified*)
+                 (bc-asynchronous-fulfillment *unspecified*))
 "
   Backward Chainer call.
 
@@ -209,9 +343,15 @@
                  #:complexity-penalty cp
                  #:jobs jb
                  #:expansion-pool-size esp
+                 #:maximum-wall-time mwt
+                 #:maximum-cpu-time mct
+                 #:maximum-pm-executions mpe
+                 #:maximum-produced-atoms mpa
+                 #:random-seed rs
                  #:bc-maximum-bit-size mbs
                  #:bc-mm-complexity-penalty mcp
-                 #:bc-mm-compressiveness mc)
+                 #:bc-mm-compressiveness mc
+                 #:bc-asynchronous-fulfillment af)
 
   rbs: ConceptNode representing a rulebase.
 
@@ -246,6 +386,23 @@
        the forward chainer), but also then the selection is more costly.
        Negative or null means unlimited (not recommended).
 
+  mwt: [optional, default=-1] Maximum wall time in seconds. When
+       reached, chaining stops and the results found so far are
+       returned. Negative means unlimited.
+
+  mct: [optional, default=-1] Maximum CPU time in seconds, of the whole
+       process. Negative means unlimited.
+
+  mpe: [optional, default=-1] Maximum number of pattern matcher
+       executions. Negative means unlimited.
+
+  mpa: [optional, default=-1] Maximum number of atoms produced by rule
+       applications, duplicates included. Negative means unlimited.
+
+  rs: [optional, default=-1] Seed of the random draws of the chainer.
+      With a given seed and a single job, chaining is reproducible.
+      Negative means drawn from the global random generator.
+
   mbs: [optional, default=-1] Maximum size of the inference tree pool
        to evolve. Negative means unlimited.
 
@@ -256,6 +413,10 @@
       control rules (how well a control rule can explain data outside of its
       context).
 
+  af: [optional, default=#f] Whether expanded and-BITs are fulfilled
+      by background workers, fittest first, while the inference tree
+      keeps being expanded.
+
   Note that the defaults of the optional arguments are not determined
   here (although they attempt to be documented here).  That is the case
   in order not to overwrite existing parameters set by
@@ -274,12 +435,24 @@
       (ure-set-jobs rbs jobs))
   (if (not (unspecified? expansion-pool-size))
       (ure-set-expansion-pool-size rbs expansion-pool-size))
+  (if (not (unspecified? maximum-wall-time))
+      (ure-set-maximum-wall-time rbs maximum-wall-time))
+  (if (not (unspecified? maximum-cpu-time))
+      (ure-set-maximum-cpu-time rbs maximum-cpu-time))
+  (if (not (unspecified? maximum-pm-executions))
+      (ure-set-maximum-pm-executions rbs maximum-pm-executions))
+  (if (not (unspecified? maximum-produced-atoms))
+      (ure-set-maximum-produced-atoms rbs maximum-produced-atoms))
+  (if (not (unspecified? random-seed))
+      (ure-set-random-seed rbs random-seed))
   (if (not (unspecified? bc-maximum-bit-size))
       (ure-set-bc-maximum-bit-size rbs bc-maximum-bit-size))
   (if (not (unspecified? bc-mm-complexity-penalty))
       (ure-set-bc-mm-complexity-penalty rbs bc-mm-complexity-penalty))
   (if (not (unspecified? bc-mm-compressiveness))
       (ure-set-bc-mm-compressiveness rbs bc-mm-compressiveness))
+  (if (not (unspecified? bc-asynchronous-fulfillment))
+      (ure-set-bc-asynchronous-fulfillment rbs bc-asynchronous-fulfillment))
 
   ;; Defined optional atomspaces and call the backward chainer
   (let* ((trace-enabled (cog-atomspace? trace-as))
@@ -781,6 +954,50 @@
     (cog-set-atomspace! current-as)
     new-param-eval))
 
+(define (ure-set-concept-parameter rbs name value)
+"
+  Set concept parameters. Given an rbs, a parameter name and its value
+  (a string), create (in the same atomspace where rbs lives)
+
+  ExecutionLink
+     SchemaNode name
+     rbs
+     ConceptNode value
+
+  If a value already exists it first delete it to make sure there is
+  only one value associated to that parameter and rule-base.
+"
+  ;; Switch to rbs atomspace
+  (define current-as (cog-set-atomspace! (cog-as rbs)))
+
+  (define (param-execution atom)
+    (ExecutionLink
+       (SchemaNode name)
+       rbs
+       atom)
+  )
+
+  ;; Delete existing value if any
+  (let* ((var (VariableNode "__VALUE__"))
+         (exec-var (param-execution var))
+         (del-prev-val (BindLink
+                         exec-var
+                         (DeleteLink exec-var))))
+    ;; Delete any previous value for that parameter
+    (cog-execute! del-prev-val)
+    ;; Delete pattern to not create to much junk in the atomspace
+    (cog-extract! del-prev-val)
+    (cog-extract! (DeleteLink exec-var))
+    (cog-extract! exec-var)
+    (cog-extract! var)
+  )
+
+  ; Set new value for that parameter, switch back to current-as and
+  ; return new value.
+  (let ((new-param-exec (param-execution (ConceptNode value))))
+    (cog-set-atomspace! current-as)
+    new-param-exec))
+
 (define (ure-set-attention-allocation rbs value)
 "
   Set the URE:attention-allocation parameter of a given RBS
@@ -848,6 +1065,71 @@
 "
   (ure-set-num-parameter rbs "URE:expansion-pool-size" value))
 
+(define (ure-set-maximum-wall-time rbs value)
+"
+  Set the URE:maximum-wall-time parameter of a given RBS
+
+  ExecutionLink
+    SchemaNode \"URE:maximum-wall-time\"
+    rbs
+    NumberNode value
+
+  Delete any previous one if exists.
+"
+  (ure-set-num-parameter rbs "URE:maximum-wall-time" value))
+
+(define (ure-set-maximum-cpu-time rbs value)
+"
+  Set the URE:maximum-cpu-time parameter of a given RBS
+
+  ExecutionLink
+    SchemaNode \"URE:maximum-cpu-time\"
+    rbs
+    NumberNode value
+
+  Delete any previous one if exists.
+"
+  (ure-set-num-parameter rbs "URE:maximum-cpu-time" value))
+
+(define (ure-set-maximum-pm-executions rbs value)
+"
+  Set the URE:maximum-pm-executions parameter of a given RBS
+
+  ExecutionLink
+    SchemaNode \"URE:maximum-pm-executions\"
+    rbs
+    NumberNode value
+
+  Delete any previous one if exists.
+"
+  (ure-set-num-parameter rbs "URE:maximum-pm-executions" value))
+
+(define (ure-set-maximum-produced-atoms rbs value)
+"
+  Set the URE:maximum-produced-atoms parameter of a given RBS
+
+  ExecutionLink
+    SchemaNode \"URE:maximum-produced-atoms\"
+    rbs
+    NumberNode value
+
+  Delete any previous one if exists.
+"
+  (ure-set-num-parameter rbs "URE:maximum-produced-atoms" value))
+
+(define (ure-set-random-seed rbs value)
+"
+  Set the URE:random-seed parameter of a given RBS
+
+  ExecutionLink
+    SchemaNode \"URE:random-seed\"
+    rbs
+    NumberNode value
+
+  Delete any previous one if exists.
+"
+  (ure-set-num-parameter rbs "URE:random-seed" value))
+
 (define (ure-set-fc-retry-exhausted-sources rbs value)
 "
   Set the URE:FC:retry-exhausted-sources parameter of a given RBS
@@ -874,6 +1156,115 @@
 "
   (ure-set-fuzzy-bool-parameter rbs "URE:FC:full-rule-application" value))
 
+(define (ure-set-fc-semi-naive rbs value)
+"
+  Set the URE:FC:semi-naive parameter of a given RBS
+
+  EvaluationLink (stv value 1)
+    PredicateNode \"URE:FC:semi-naive\"
+    rbs
+
+  If the provided value is a boolean, then it is automatically
+  converted into tv.
+"
+  (ure-set-fuzzy-bool-parameter rbs "URE:FC:semi-naive" value))
+
+(define (ure-set-fc-match-network rbs value)
+"
+  Set the URE:FC:match-network parameter of a given RBS
+
+  EvaluationLink (stv value 1)
+    PredicateNode \"URE:FC:match-network\"
+    rbs
+
+  If the provided value is a boolean, then it is automatically
+  converted into tv.
+"
+  (ure-set-fuzzy-bool-parameter rbs "URE:FC:match-network" value))
+
+(define (ure-set-fc-source-selection-mode rbs value)
+"
+  Set the URE:FC:source-selection-mode parameter of a given RBS
+
+  ExecutionLink
+    SchemaNode \"URE:FC:source-selection-mode\"
+    rbs
+    ConceptNode value
+
+  where value is either \"tv-fitness\", \"tournament\" or \"uniform\".
+
+  Delete any previous one if exists.
+"
+  (ure-set-concept-parameter rbs "URE:FC:source-selection-mode" value))
+
+(define (ure-set-fc-source-rule-selection-mode rbs value)
+"
+  Set the URE:FC:source-rule-selection-mode parameter of a given RBS
+
+  ExecutionLink
+    SchemaNode \"URE:FC:source-rule-selection-mode\"
+    rbs
+    ConceptNode value
+
+  where value is either \"thompson\", \"tv-fitness\", \"tournament\"
+  or \"uniform\".
+
+  Delete any previous one if exists.
+"
+  (ure-set-concept-parameter rbs "URE:FC:source-rule-selection-mode" value))
+
+(define (ure-set-fc-tournament-size rbs value)
+"
+  Set the URE:FC:tournament-size parameter of a given RBS
+
+  ExecutionLink
+    SchemaNode \"URE:FC:tournament-size\"
+    rbs
+    NumberNode value
+
+  Delete any previous one if exists.
+"
+  (ure-set-num-parameter rbs "URE:FC:tournament-size" value))
+
+(define (ure-set-fc-batch-size rbs value)
+"
+  Set the URE:FC:batch-size parameter of a given RBS
+
+  ExecutionLink
+    SchemaNode \"URE:FC:batch-size\"
+    rbs
+    NumberNode value
+
+  Delete any previous one if exists.
+"
+  (ure-set-num-parameter rbs "URE:FC:batch-size" value))
+
+(define (ure-set-fc-inference-log-size rbs value)
+"
+  Set the URE:FC:inference-log-size parameter of a given RBS
+
+  ExecutionLink
+    SchemaNode \"URE:FC:inference-log-size\"
+    rbs
+    NumberNode value
+
+  Delete any previous one if exists.
+"
+  (ure-set-num-parameter rbs "URE:FC:inference-log-size" value))
+
+(define (ure-set-fc-maximum-sources rbs value)
+"
+  Set the URE:FC:maximum-sources parameter of a given RBS
+
+  ExecutionLink
+    SchemaNode \"URE:FC:maximum-sources\"
+    rbs
+    NumberNode value
+
+  Delete any previous one if exists.
+"
+  (ure-set-num-parameter rbs "URE:FC:maximum-sources" value))
+
 (define (ure-set-bc-maximum-bit-size rbs value)
 "
   Set the URE:BC:maximum-bit-size parameter of a given RBS
@@ -913,6 +1304,19 @@
 "
   (ure-set-num-parameter rbs "URE:BC:MM:compressiveness" value))
 
+(define (ure-set-bc-asynchronous-fulfillment rbs value)
+"
+  Set the URE:BC:asynchronous-fulfillment parameter of a given RBS
+
+  EvaluationLink (stv value 1)
+    PredicateNode \"URE:BC:asynchronous-fulfillment\"
+    rbs
+
+  If the provided value is a boolean, then it is automatically
+  converted into tv.
+"
+  (ure-set-fuzzy-bool-parameter rbs "URE:BC:asynchronous-fulfillment" value))
+
 (define-public (ure-define-rbs rbs iteration)
 "
   Transforms the atom into a node that represents a rulebase and returns it.
@@ -1294,16 +1698,31 @@
           ure-rm-rule-names
           ure-set-num-parameter
           ure-set-fuzzy-bool-parameter
+          ure-set-concept-parameter
           ure-set-attention-allocation
           ure-set-maximum-iterations
           ure-set-complexity-penalty
           ure-set-jobs
           ure-set-expansion-pool-size
+          ure-set-maximum-wall-time
+          ure-set-maximum-cpu-time
+          ure-set-maximum-pm-executions
+          ure-set-maximum-produced-atoms
+          ure-set-random-seed
           ure-set-fc-retry-exhausted-sources
           ure-set-fc-full-rule-application
+          ure-set-fc-semi-naive
+          ure-set-fc-match-network
+          ure-set-fc-source-selection-mode
+          ure-set-fc-source-rule-selection-mode
+          ure-set-fc-tournament-size
+          ure-set-fc-batch-size
+          ure-set-fc-inference-log-size
+          ure-set-fc-maximum-sources
           ure-set-bc-maximum-bit-size
           ure-set-bc-mm-complexity-penalty
           ure-set-bc-mm-compressiveness
+          ure-set-bc-asynchronous-fulfillment
           ure-define-rbs
           ure-get-forward-rule
           ure-logger-set-level!
@@ -0,0 +1,103 @@
+/*
+ * Budget.cc
+ *
+ * Copyright (C) 2020 SingularityNET Foundation
+ *
+ * Authors: Nil Geisweiller
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License v3 as
+ * published by the Free Software Foundation and including the exceptions
+ * at http://opencog.org/wiki/Licenses
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program; if not, write to:
+ * Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "Budget.h"
+
+namespace opencog {
+
+Budget::Budget(const UREConfig& config)
+	: _config(config),
+	  _wall_start(std::chrono::steady_clock::now()),
+	  _cpu_start(std::clock()),
+	  _pm_executions(0),
+	  _produced_atoms(0)
+{
+}
+
+void Budget::start()
+{
+	_wall_start = std::chrono::steady_clock::now();
+	_cpu_start = std::clock();
+	_pm_executions = 0;
+	_produced_atoms = 0;
+}
+
+void Budget::add_pm_execution()
+{
+	_pm_executions++;
+}
+
+void Budget::add_produced_atoms(size_t n)
+{
+	_produced_atoms += n;
+}
+
+bool Budget::is_exhausted() const
+{
+	return not exhausted_msg().empty();
+}
+
+std::string Budget::exhausted_msg() const
+{
+	int max_pme = _config.get_maximum_pm_executions();
+	if (0 <= max_pme and (size_t)max_pme <= _pm_executions)
+		return "reached the maximum number of pattern matcher executions";
+
+	int max_pa = _config.get_maximum_produced_atoms();
+	if (0 <= max_pa and (size_t)max_pa <= _produced_atoms)
+		return "reached the maximum number of produced atoms";
+
+	double max_wt = _config.get_maximum_wall_time();
+	if (0 <= max_wt and max_wt <= get_wall_time())
+		return "reached the maximum wall time";
+
+	double max_ct = _config.get_maximum_cpu_time();
+	if (0 <= max_ct and max_ct <= get_cpu_time())
+		return "reached the maximum CPU time";
+
+	return "";
+}
+
+double Budget::get_wall_time() const
+{
+	std::chrono::duration<double> elapsed =
+		std::chrono::steady_clock::now() - _wall_start;
+	return elapsed.count();
+}
+
+double Budget::get_cpu_time() const
+{
+	return double(std::clock() - _cpu_start) / CLOCKS_PER_SEC;
+}
+
+size_t Budget::get_pm_executions() const
+{
+	return _pm_executions;
+}
+
+size_t Budget::get_produced_atoms() const
+{
+	return _produced_atoms;
+}
+
+} // ~namespace opencog
@@ -0,0 +1,95 @@
+/*
+ * Budget.h
+ *
+ * Copyright (C) 2020 SingularityNET Foundation
+ *
+ * Authors: Nil Geisweiller
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License v3 as
+ * published by the Free Software Foundation and including the exceptions
+ * at http://opencog.org/wiki/Licenses
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program; if not, write to:
+ * Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+#ifndef _OPENCOG_URE_BUDGET_H_
+#define _OPENCOG_URE_BUDGET_H_
+
+#include <atomic>
+#include <chrono>
+#include <ctime>
+
+#include "UREConfig.h"
+
+namespace opencog
+{
+
+/**
+ * Resource budget of a chainer, as configured by the maximum wall
+ * time, CPU time, pattern matcher executions and produced atoms
+ * parameters of UREConfig. Negative limits mean unlimited.
+ *
+ * The chainer calls start() before chaining, reports its pattern
+ * matcher executions and products as it goes, and checks
+ * is_exhausted() in its termination criteria. Counters are atomic so
+ * that multiple threads of the same chainer may report concurrently.
+ */
+class Budget
+{
+public:
+	Budget(const UREConfig& config);
+
+	/**
+	 * Reset the counters and start the clocks.
+	 */
+	void start();
+
+	/**
+	 * Report resource consumption.
+	 */
+	void add_pm_execution();
+	void add_produced_atoms(size_t n);
+
+	/**
+	 * Return true iff any limit has been reached. The counters are
+	 * checked first, then the clocks, so that the common case costs
+	 * little more than a few comparisons.
+	 */
+	bool is_exhausted() const;
+
+	/**
+	 * Return a description of the limit that has been reached, or
+	 * the empty string if none.
+	 */
+	std::string exhausted_msg() const;
+
+	/**
+	 * Consumption so far. Times are in seconds. CPU time is the one
+	 * of the whole process, thus includes the other threads.
+	 */
+	double get_wall_time() const;
+	double get_cpu_time() const;
+	size_t get_pm_executions() const;
+	size_t get_produced_atoms() const;
+
+private:
+	const UREConfig& _config;
+
+	std::chrono::steady_clock::time_point _wall_start;
+	std::clock_t _cpu_start;
+
+	std::atomic<size_t> _pm_executions;
+	std::atomic<size_t> _produced_atoms;
+};
+
+} // ~namespace opencog
+
+#endif /* _OPENCOG_URE_BUDGET_H_ */
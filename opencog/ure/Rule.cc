@@ -55,8 +55,22 @@ bool rule_ptr_less::operator()(const RulePtr& l, const RulePtr& r) const
 
 void RuleSet::expand_meta_rules(AtomSpace& as)
 {
-	// TODO: could certainly be optimized by not systematically
-	// recollecting and re-instantiating meta-rules.
+	// See the incremental version of expand_meta_rules to avoid
+	// systematically re-instantiating meta-rules over the whole
+	// atomspace.
+	RuleSet meta_rules;
+	for (RulePtr rule : *this) {
+		if (rule->is_meta()) {
+			meta_rules.insert(rule);
+		}
+	}
+
+	for (RulePtr rule : meta_rules)
+		insert_produced_rules(*rule, rule->apply(as));
+}
+
+void RuleSet::expand_meta_rules(AtomSpace& as, const HandleSet& new_atoms)
+{
 	RuleSet meta_rules;
 	for (RulePtr rule : *this) {
 		if (rule->is_meta()) {
@@ -65,15 +79,31 @@ void RuleSet::expand_meta_rules(AtomSpace& as)
 	}
 
 	for (RulePtr rule : meta_rules) {
-		Handle result = rule->apply(as);
-		for (const Handle& produced_h : result->getOutgoingSet()) {
-			RulePtr produced =
-				createRule(rule->get_alias(), produced_h, rule->get_rbs());
-			auto [_, ir] = insert(produced);
-			if (ir) {
-				ure_logger().debug() << "New rule instantiated from a meta rule:"
-											<< std::endl << oc_to_string(*produced);
-			}
+		for (const Handle& h : new_atoms) {
+			RuleTypedSubstitutionMap urm = rule->unify_source(h, Handle::UNDEFINED, &as);
+			for (const RulePtr& ur : Rule::strip_typed_substitution(urm))
+				insert_produced_rules(*rule, ur->apply(as));
+		}
+	}
+}
+
+bool RuleSet::has_meta_rules() const
+{
+	for (const RulePtr& rule : *this)
+		if (rule->is_meta())
+			return true;
+	return false;
+}
+
+void RuleSet::insert_produced_rules(const Rule& meta_rule, const Handle& result)
+{
+	for (const Handle& produced_h : result->getOutgoingSet()) {
+		RulePtr produced =
+			createRule(meta_rule.get_alias(), produced_h, meta_rule.get_rbs());
+		auto [_, ir] = insert(produced);
+		if (ir) {
+			ure_logger().debug() << "New rule instantiated from a meta rule:"
+			                     << std::endl << oc_to_string(*produced);
 		}
 	}
 }
@@ -175,7 +205,7 @@ Rule::Rule(const Rule& r)
 	_name = r._name;
 	_rbs = r._rbs;
 	_tv = r._tv;
-	_exhausted = r._exhausted;
+	_exhausted = r._exhausted.load();
 }
 
 Rule::Rule(const Handle& rule_alias, const Handle& rbs)
@@ -266,7 +296,7 @@ Rule& Rule::operator=(const Rule& r)
 	_name = r._name;
 	_rbs = r._rbs;
 	_tv = r._tv;
-	_exhausted = r._exhausted;
+	_exhausted = r._exhausted.load();
 
 	return *this;
 }
@@ -600,19 +630,16 @@ Handle Rule::apply(AtomSpace& as) const
 
 void Rule::set_exhausted()
 {
-	std::lock_guard<std::mutex> lock(_mutex);
 	_exhausted = true;
 }
 
 void Rule::reset_exhausted()
 {
-	std::lock_guard<std::mutex> lock(_mutex);
 	_exhausted = false;
 }
 
 bool Rule::is_exhausted() const
 {
-	std::lock_guard<std::mutex> lock(_mutex);
 	return _exhausted;
 }
 
@@ -26,6 +26,8 @@
 #ifndef _OPENCOG_RULE_H_
 #define _OPENCOG_RULE_H_
 
+#include <atomic>
+
 #include <boost/operators.hpp>
 #include <opencog/atomspace/AtomSpace.h>
 #include <opencog/atoms/core/ScopeLink.h>
@@ -57,6 +59,11 @@ class RuleSet : public std::vector<RulePtr>,
 {
 	typedef std::vector<RulePtr> super;
 
+	/**
+	 * Insert the rules produced by a meta rule.
+	 */
+	void insert_produced_rules(const Rule& meta_rule, const Handle& result);
+
 public:
 	/**
 	 * Run all meta rules over as and insert the resulting rules back
@@ -64,6 +71,20 @@ public:
 	 */
 	void expand_meta_rules(AtomSpace& as);
 
+	/**
+	 * Incremental version of expand_meta_rules. Only run the
+	 * specializations of the meta rules obtained by unifying their
+	 * premises with new atoms, that is atoms added to as since the
+	 * last expansion. Groundings made of old atoms only have already
+	 * been expanded and are not enumerated again.
+	 */
+	void expand_meta_rules(AtomSpace& as, const HandleSet& new_atoms);
+
+	/**
+	 * Return true iff the rule set contains meta rules.
+	 */
+	bool has_meta_rules() const;
+
 	/**
 	 * Return the set of rule aliases, as aliases of inference rules
 	 * are used in control rules.
@@ -368,10 +389,7 @@ private:
 	TruthValuePtr _tv;
 
 	// True if the rule has already been applied.
-	bool _exhausted;
-
-	// TODO: subdivide in smaller and shared mutexes
-	mutable std::mutex _mutex;
+	std::atomic<bool> _exhausted;
 
 	// Return a copy of the rule with the variables alpha-converted
 	// into random variable names.
@@ -0,0 +1,137 @@
+/*
+ * SumTree.cc
+ *
+ * Copyright (C) 2020 SingularityNET Foundation
+ *
+ * Authors: Nil Geisweiller
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License v3 as
+ * published by the Free Software Foundation and including the exceptions
+ * at http://opencog.org/wiki/Licenses
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program; if not, write to:
+ * Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "SumTree.h"
+
+#include <random>
+#include <sstream>
+
+#include <opencog/util/oc_assert.h>
+
+namespace opencog {
+
+SumTree::SumTree()
+	: _capacity(1), _size(0), _nodes(2, 0.0)
+{
+}
+
+size_t SumTree::size() const
+{
+	return _size;
+}
+
+bool SumTree::empty() const
+{
+	return _size == 0;
+}
+
+void SumTree::push_back(double weight)
+{
+	if (_size == _capacity) {
+		// Double the capacity and rebuild the tree. Leaves are copied
+		// in the second half, then internal nodes recomputed bottom-up.
+		std::vector<double> nodes(4 * _capacity, 0.0);
+		std::copy(std::next(_nodes.begin(), _capacity), _nodes.end(),
+		          std::next(nodes.begin(), 2 * _capacity));
+		_capacity *= 2;
+		for (size_t k = _capacity - 1; 0 < k; k--)
+			nodes[k] = nodes[2 * k] + nodes[2 * k + 1];
+		_nodes.swap(nodes);
+	}
+	_size++;
+	set(_size - 1, weight);
+}
+
+void SumTree::set(size_t i, double weight)
+{
+	OC_ASSERT(i < _size);
+	OC_ASSERT(0.0 <= weight, "weight = %g should be non-negative", weight);
+	size_t node = _capacity + i;
+	_nodes[node] = weight;
+	update_ancestors(node);
+}
+
+double SumTree::get(size_t i) const
+{
+	OC_ASSERT(i < _size);
+	return _nodes[_capacity + i];
+}
+
+double SumTree::total() const
+{
+	return _nodes[1];
+}
+
+size_t SumTree::find(double u) const
+{
+	OC_ASSERT(0.0 < total(), "total = %g should be positive", total());
+	size_t node = 1;
+	while (node < _capacity) {
+		size_t left = 2 * node, right = left + 1;
+		// Never descend into a null subtree, which could otherwise
+		// happen due to rounding errors when u is close to a bound.
+		if (_nodes[right] == 0.0 or (u < _nodes[left] and 0.0 < _nodes[left])) {
+			node = left;
+		} else {
+			u -= _nodes[left];
+			node = right;
+		}
+	}
+	return node - _capacity;
+}
+
+size_t SumTree::operator()(RandGen& rng) const
+{
+	std::uniform_real_distribution<double> dist(0.0, total());
+	return find(dist(rng));
+}
+
+void SumTree::clear()
+{
+	_capacity = 1;
+	_size = 0;
+	_nodes.assign(2, 0.0);
+}
+
+std::string SumTree::to_string(const std::string& indent) const
+{
+	std::stringstream ss;
+	ss << indent << "size = " << _size << std::endl
+	   << indent << "total = " << total();
+	for (size_t i = 0; i < _size; i++)
+		ss << std::endl << indent << "weight[" << i << "] = " << get(i);
+	return ss.str();
+}
+
+void SumTree::update_ancestors(size_t node)
+{
+	for (node /= 2; 0 < node; node /= 2)
+		_nodes[node] = _nodes[2 * node] + _nodes[2 * node + 1];
+}
+
+std::string oc_to_string(const SumTree& st, const std::string& indent)
+{
+	return st.to_string(indent);
+}
+
+} // ~namespace opencog
@@ -0,0 +1,123 @@
+/*
+ * SumTree.h
+ *
+ * Copyright (C) 2020 SingularityNET Foundation
+ *
+ * Authors: Nil Geisweiller
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License v3 as
+ * published by the Free Software Foundation and including the exceptions
+ * at http://opencog.org/wiki/Licenses
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program; if not, write to:
+ * Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+#ifndef _OPENCOG_SUM_TREE_H_
+#define _OPENCOG_SUM_TREE_H_
+
+#include <vector>
+
+#include <opencog/util/mt19937ar.h>
+#include <opencog/util/empty_string.h>
+
+namespace opencog
+{
+
+/**
+ * Sequence of non-negative weights supporting update, insertion and
+ * weighted sampling in O(log n).
+ *
+ * It is implemented as a complete binary tree stored in a contiguous
+ * array, where each leaf holds a weight and each internal node holds
+ * the sum of its children. Internal nodes are always recomputed from
+ * their children, rather than incremented, so that no rounding error
+ * accumulates over updates, and in particular so that the total is
+ * exactly zero when all weights are.
+ */
+class SumTree
+{
+public:
+	SumTree();
+
+	/**
+	 * Number of weights
+	 */
+	size_t size() const;
+	bool empty() const;
+
+	/**
+	 * Append a weight, amortized O(log n).
+	 */
+	void push_back(double weight);
+
+	/**
+	 * Set the weight at index i, O(log n).
+	 */
+	void set(size_t i, double weight);
+
+	/**
+	 * Get the weight at index i, O(1).
+	 */
+	double get(size_t i) const;
+
+	/**
+	 * Sum of all weights, O(1).
+	 */
+	double total() const;
+
+	/**
+	 * Return the index i such that the sum of the weights before i is
+	 * lower than or equal to u, and the sum of the weights up to i
+	 * included is greater than u. Only indices with positive weights
+	 * are returned.
+	 *
+	 * The total must be positive.
+	 */
+	size_t find(double u) const;
+
+	/**
+	 * Sample an index with probability proportional to its weight.
+	 *
+	 * The total must be positive.
+	 */
+	size_t operator()(RandGen& rng=randGen()) const;
+
+	/**
+	 * Remove all weights.
+	 */
+	void clear();
+
+	std::string to_string(const std::string& indent=empty_string) const;
+
+private:
+	/**
+	 * Recompute the sums of the ancestors of the given leaf node
+	 */
+	void update_ancestors(size_t node);
+
+	// Number of leaves, a power of 2 greater or equal to _size
+	size_t _capacity;
+
+	// Number of weights
+	size_t _size;
+
+	// Nodes of the tree. _nodes[1] is the root, the children of node
+	// k are 2k and 2k+1, and the weight of index i is in leaf
+	// _capacity + i. _nodes[0] is unused.
+	std::vector<double> _nodes;
+};
+
+std::string oc_to_string(const SumTree& st,
+                         const std::string& indent=empty_string);
+
+} // ~namespace opencog
+
+#endif /* _OPENCOG_SUM_TREE_H_ */
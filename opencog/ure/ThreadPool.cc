@@ -0,0 +1,129 @@
+/*
+ * ThreadPool.cc
+ *
+ * Copyright (C) 2020 SingularityNET Foundation
+ *
+ * Authors: Nil Geisweiller
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License v3 as
+ * published by the Free Software Foundation and including the exceptions
+ * at http://opencog.org/wiki/Licenses
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program; if not, write to:
+ * Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include <algorithm>
+
+#include "ThreadPool.h"
+
+namespace opencog {
+
+// Pool and queue index of the current thread, if it is a worker, so
+// that tasks submitted from a worker go to its own queue.
+static thread_local const ThreadPool* local_pool = nullptr;
+static thread_local unsigned local_queue = 0;
+
+ThreadPool::ThreadPool(unsigned n_workers)
+	: _pending(0), _next_queue(0), _stop(false)
+{
+	if (n_workers == 0)
+		n_workers = std::max(1U, std::thread::hardware_concurrency());
+
+	for (unsigned i = 0; i < n_workers; i++)
+		_queues.emplace_back(new WorkQueue());
+	for (unsigned i = 0; i < n_workers; i++)
+		_workers.emplace_back([this, i]() { work(i); });
+}
+
+ThreadPool::~ThreadPool()
+{
+	{
+		std::lock_guard<std::mutex> lock(_idle_mutex);
+		_stop = true;
+	}
+	_idle_cv.notify_all();
+	for (std::thread& worker : _workers)
+		worker.join();
+}
+
+unsigned ThreadPool::size() const
+{
+	return _workers.size();
+}
+
+void ThreadPool::push(Task task)
+{
+	unsigned i = local_pool == this ? local_queue
+		: _next_queue++ % _queues.size();
+	{
+		// Increment before the task is visible, so that a worker
+		// popping it never decrements ahead of the increment, and
+		// under the idle mutex so that a worker about to sleep cannot
+		// miss the notification.
+		std::lock_guard<std::mutex> lock(_idle_mutex);
+		_pending++;
+	}
+	{
+		std::lock_guard<std::mutex> lock(_queues[i]->mutex);
+		_queues[i]->tasks.push_back(std::move(task));
+	}
+	_idle_cv.notify_one();
+}
+
+void ThreadPool::work(unsigned i)
+{
+	local_pool = this;
+	local_queue = i;
+
+	while (true) {
+		Task task;
+		if (pop(i, task) or steal(i, task)) {
+			_pending--;
+			task();
+			continue;
+		}
+
+		// Nothing to do, sleep till a task is pushed or the pool is
+		// stopped. Pending tasks are always processed before stopping.
+		std::unique_lock<std::mutex> lock(_idle_mutex);
+		_idle_cv.wait(lock, [&]() { return _stop or 0 < _pending; });
+		if (_stop and _pending == 0)
+			return;
+	}
+}
+
+bool ThreadPool::pop(unsigned i, Task& task)
+{
+	WorkQueue& queue = *_queues[i];
+	std::lock_guard<std::mutex> lock(queue.mutex);
+	if (queue.tasks.empty())
+		return false;
+	task = std::move(queue.tasks.back());
+	queue.tasks.pop_back();
+	return true;
+}
+
+bool ThreadPool::steal(unsigned i, Task& task)
+{
+	for (unsigned k = 1; k < _queues.size(); k++) {
+		WorkQueue& queue = *_queues[(i + k) % _queues.size()];
+		std::lock_guard<std::mutex> lock(queue.mutex);
+		if (queue.tasks.empty())
+			continue;
+		task = std::move(queue.tasks.front());
+		queue.tasks.pop_front();
+		return true;
+	}
+	return false;
+}
+
+} // ~namespace opencog
@@ -0,0 +1,139 @@
+/*
+ * ThreadPool.h
+ *
+ * Copyright (C) 2020 SingularityNET Foundation
+ *
+ * Authors: Nil Geisweiller
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License v3 as
+ * published by the Free Software Foundation and including the exceptions
+ * at http://opencog.org/wiki/Licenses
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program; if not, write to:
+ * Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+#ifndef _OPENCOG_THREAD_POOL_H_
+#define _OPENCOG_THREAD_POOL_H_
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+namespace opencog
+{
+
+/**
+ * Persistent pool of worker threads with work stealing.
+ *
+ * Each worker owns a task queue. Tasks submitted from outside the
+ * pool are distributed in a round robin fashion over the queues,
+ * tasks submitted from a worker go to that worker's queue. A worker
+ * takes tasks from the back of its own queue, and when it is empty,
+ * steals from the front of the queues of the other workers. Idle
+ * workers sleep on a condition variable, so that no thread is ever
+ * created or destroyed during the lifetime of the pool.
+ *
+ * Completion is reported via the future returned by submit().
+ */
+class ThreadPool
+{
+public:
+	typedef std::function<void()> Task;
+
+	/**
+	 * Create and start a pool of n_workers threads. If n_workers is
+	 * zero, then the number of hardware threads is used instead.
+	 */
+	ThreadPool(unsigned n_workers=0);
+
+	/**
+	 * Wait for all submitted tasks to be processed, then join all
+	 * workers.
+	 */
+	~ThreadPool();
+
+	ThreadPool(const ThreadPool&) = delete;
+	ThreadPool& operator=(const ThreadPool&) = delete;
+
+	/**
+	 * Submit a callable to the pool. Return a future holding its
+	 * result, or the exception it has thrown.
+	 */
+	template<typename F>
+	std::future<std::invoke_result_t<std::decay_t<F>>> submit(F&& f)
+	{
+		typedef std::invoke_result_t<std::decay_t<F>> R;
+		auto task = std::make_shared<std::packaged_task<R()>>(std::forward<F>(f));
+		std::future<R> result = task->get_future();
+		push([task]() { (*task)(); });
+		return result;
+	}
+
+	/**
+	 * Number of workers.
+	 */
+	unsigned size() const;
+
+private:
+	struct WorkQueue
+	{
+		std::deque<Task> tasks;
+		std::mutex mutex;
+	};
+
+	/**
+	 * Insert a task in a worker queue and wake up an idle worker.
+	 */
+	void push(Task task);
+
+	/**
+	 * Main loop of worker i.
+	 */
+	void work(unsigned i);
+
+	/**
+	 * Pop a task from the back of the queue of worker i. Return false
+	 * if that queue is empty.
+	 */
+	bool pop(unsigned i, Task& task);
+
+	/**
+	 * Steal a task from the front of the queue of any worker other
+	 * than i. Return false if all queues are empty.
+	 */
+	bool steal(unsigned i, Task& task);
+
+	std::vector<std::unique_ptr<WorkQueue>> _queues;
+	std::vector<std::thread> _workers;
+
+	// Number of tasks submitted but not yet taken by a worker
+	std::atomic<size_t> _pending;
+
+	// Index of the queue receiving the next task submitted from
+	// outside the pool
+	std::atomic<unsigned> _next_queue;
+
+	// Guard _stop and put idle workers to sleep
+	std::mutex _idle_mutex;
+	std::condition_variable _idle_cv;
+	bool _stop;
+};
+
+} // ~namespace opencog
+
+#endif /* _OPENCOG_THREAD_POOL_H_ */
@@ -0,0 +1,186 @@
+/*
+ * TraceWriter.cc
+ *
+ * Copyright (C) 2020 SingularityNET Foundation
+ *
+ * Authors: Nil Geisweiller
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License v3 as
+ * published by the Free Software Foundation and including the exceptions
+ * at http://opencog.org/wiki/Licenses
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program; if not, write to:
+ * Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "TraceWriter.h"
+
+#include <opencog/atoms/base/Link.h>
+#include <opencog/atoms/base/Node.h>
+
+#include "URELogger.h"
+
+namespace opencog {
+
+TraceWriter::TraceWriter(AtomSpace& trace_as)
+	: _trace_as(trace_as), _pending(nullptr), _submitted(0), _written(0),
+	  _stop(false)
+{
+	_writer = std::thread([this]() { run(); });
+}
+
+TraceWriter::~TraceWriter()
+{
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		_stop = true;
+	}
+	_pending_cv.notify_one();
+	_writer.join();
+}
+
+void TraceWriter::write_executions(const Handle& schema, HandleSeq inputs,
+                                   HandleSeq outputs, TruthValuePtr tv,
+                                   int step,
+                                   std::vector<bool> dont_exec_inputs,
+                                   bool dont_exec_outputs)
+{
+	push(new Trace{EXECUTION_LINK, schema, std::move(inputs),
+	               std::move(outputs), step, tv,
+	               std::move(dont_exec_inputs), dont_exec_outputs, nullptr});
+}
+
+void TraceWriter::write_evaluation(const Handle& predicate,
+                                   HandleSeq arguments, TruthValuePtr tv,
+                                   std::vector<bool> dont_exec_arguments)
+{
+	push(new Trace{EVALUATION_LINK, predicate, std::move(arguments),
+	               HandleSeq(), -1, tv, std::move(dont_exec_arguments),
+	               false, nullptr});
+}
+
+void TraceWriter::push(Trace* trace)
+{
+	trace->next = _pending.load();
+	while (not _pending.compare_exchange_weak(trace->next, trace));
+	_submitted++;
+
+	// Only wake up the writer if the stack was empty, otherwise it
+	// is either awake or about to be. Locking guarantees that the
+	// notification is not lost if it is about to sleep.
+	if (not trace->next) {
+		{ std::lock_guard<std::mutex> lock(_mutex); }
+		_pending_cv.notify_one();
+	}
+}
+
+void TraceWriter::flush()
+{
+	size_t submitted = _submitted;
+	std::unique_lock<std::mutex> lock(_mutex);
+	_written_cv.wait(lock, [&]() { return submitted <= _written; });
+}
+
+void TraceWriter::run()
+{
+	while (true) {
+		Trace* traces = _pending.exchange(nullptr);
+		if (traces) {
+			size_t n = add_all(traces);
+			{
+				std::lock_guard<std::mutex> lock(_mutex);
+				_written += n;
+			}
+			_written_cv.notify_all();
+			continue;
+		}
+
+		// Nothing to write, sleep till a trace is submitted or the
+		// writer is stopped. Pending traces are always written
+		// before stopping.
+		std::unique_lock<std::mutex> lock(_mutex);
+		_pending_cv.wait(lock, [&]() { return _stop or _pending.load(); });
+		if (_stop and not _pending.load())
+			return;
+	}
+}
+
+size_t TraceWriter::add_all(Trace* traces)
+{
+	// Reverse the stack to add the traces in order of submission, so
+	// that a later TV overwrites an earlier one.
+	Trace* ordered = nullptr;
+	while (traces) {
+		Trace* next = traces->next;
+		traces->next = ordered;
+		ordered = traces;
+		traces = next;
+	}
+
+	size_t n = 0;
+	while (ordered) {
+		add(*ordered);
+		Trace* next = ordered->next;
+		delete ordered;
+		ordered = next;
+		n++;
+	}
+	return n;
+}
+
+void TraceWriter::add(const Trace& trace)
+{
+	// A trace failing to be built or added must not kill the writer,
+	// but must not go unnoticed either.
+	try {
+		HandleSeq inputs(trace.inputs);
+		for (size_t i = 0; i < inputs.size(); i++)
+			if (i < trace.dont_exec_inputs.size() and trace.dont_exec_inputs[i])
+				inputs[i] = createLink(DONT_EXEC_LINK, inputs[i]);
+		if (0 <= trace.step)
+			inputs.push_back(createNode(NUMBER_NODE, std::to_string(trace.step)));
+		Handle input = inputs.size() == 1 ? inputs.front()
+			: createLink(std::move(inputs), LIST_LINK);
+
+		if (trace.type == EXECUTION_LINK)
+			for (const Handle& output : trace.outputs)
+				add(createLink(EXECUTION_LINK, trace.head, input,
+				               trace.dont_exec_outputs ?
+				               createLink(DONT_EXEC_LINK, output) : output),
+				    trace.tv);
+		else
+			add(createLink(trace.type, trace.head, input), trace.tv);
+	}
+	catch (const std::exception& e) {
+		ure_logger().warn() << "Failed to build trace of "
+		                    << trace.head->to_short_string() << ": "
+		                    << e.what();
+	}
+}
+
+void TraceWriter::add(const Handle& link, TruthValuePtr tv)
+{
+	try {
+		Handle h = _trace_as.add_atom(link);
+		if (tv)
+			h->setTruthValue(tv);
+	}
+	catch (const std::exception& e) {
+		ure_logger().warn() << "Failed to add trace: " << e.what()
+		                    << std::endl << oc_to_string(link);
+	}
+	catch (...) {
+		ure_logger().warn() << "Failed to add trace:" << std::endl
+		                    << oc_to_string(link);
+	}
+}
+
+} // ~namespace opencog
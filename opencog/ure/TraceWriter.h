@@ -0,0 +1,168 @@
+/*
+ * TraceWriter.h
+ *
+ * Copyright (C) 2020 SingularityNET Foundation
+ *
+ * Authors: Nil Geisweiller
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License v3 as
+ * published by the Free Software Foundation and including the exceptions
+ * at http://opencog.org/wiki/Licenses
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program; if not, write to:
+ * Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+#ifndef _OPENCOG_TRACE_WRITER_H_
+#define _OPENCOG_TRACE_WRITER_H_
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include <opencog/atomspace/AtomSpace.h>
+
+namespace opencog
+{
+
+/**
+ * Write inference traces into a trace atomspace from a background
+ * thread.
+ *
+ * Traces are passed as tuples of existing atoms, a schema or
+ * predicate, its inputs and outputs, with an optional TV, and pushed
+ * on a lock-free stack. The writer thread takes the whole stack at
+ * once, builds the trace links and adds them to the trace atomspace
+ * in order of submission, so that the cost of creating and inserting
+ * them is kept off the inference path. That includes the DontExecLinks
+ * wrapping some inputs or outputs, which are requested by flags.
+ */
+class TraceWriter
+{
+public:
+	TraceWriter(AtomSpace& trace_as);
+
+	/**
+	 * Write all pending traces, then join the writer thread.
+	 */
+	~TraceWriter();
+
+	TraceWriter(const TraceWriter&) = delete;
+	TraceWriter& operator=(const TraceWriter&) = delete;
+
+	/**
+	 * Submit, for each output, the trace
+	 *
+	 * Execution <tv>
+	 *   <schema>
+	 *   <inputs>
+	 *   <output>
+	 *
+	 * where the inputs are wrapped in a ListLink, unless there is
+	 * only one. If step is non-negative, NumberNode <step> is
+	 * appended to the inputs.
+	 *
+	 * Input i is wrapped in a DontExecLink if dont_exec_inputs[i] is
+	 * true, and so are the outputs if dont_exec_outputs is true.
+	 */
+	void write_executions(const Handle& schema, HandleSeq inputs,
+	                      HandleSeq outputs, TruthValuePtr tv=nullptr,
+	                      int step=-1,
+	                      std::vector<bool> dont_exec_inputs={},
+	                      bool dont_exec_outputs=false);
+
+	/**
+	 * Submit the trace
+	 *
+	 * Evaluation <tv>
+	 *   <predicate>
+	 *   <arguments>
+	 *
+	 * where the arguments are wrapped in a ListLink, unless there is
+	 * only one. Argument i is wrapped in a DontExecLink if
+	 * dont_exec_arguments[i] is true.
+	 */
+	void write_evaluation(const Handle& predicate, HandleSeq arguments,
+	                      TruthValuePtr tv=nullptr,
+	                      std::vector<bool> dont_exec_arguments={});
+
+	/**
+	 * Wait till all traces submitted so far have been added to the
+	 * trace atomspace.
+	 */
+	void flush();
+
+private:
+	struct Trace
+	{
+		// EXECUTION_LINK or EVALUATION_LINK
+		Type type;
+		// Schema or predicate
+		Handle head;
+		HandleSeq inputs;
+		// Outputs of an execution, one link is built per output
+		HandleSeq outputs;
+		// Appended to the inputs as a NumberNode if non-negative
+		int step;
+		TruthValuePtr tv;
+		// Inputs, and outputs, to wrap in a DontExecLink
+		std::vector<bool> dont_exec_inputs;
+		bool dont_exec_outputs;
+		Trace* next;
+	};
+
+	/**
+	 * Push a trace on the stack of pending traces.
+	 */
+	void push(Trace* trace);
+
+	/**
+	 * Build the links of a trace and add them to the trace
+	 * atomspace. Failures are logged as warnings.
+	 */
+	void add(const Trace& trace);
+	void add(const Handle& link, TruthValuePtr tv);
+
+	/**
+	 * Main loop of the writer thread.
+	 */
+	void run();
+
+	/**
+	 * Add a stack of traces to the trace atomspace, from bottom to
+	 * top, and delete them. Return the number of traces.
+	 */
+	size_t add_all(Trace* traces);
+
+	AtomSpace& _trace_as;
+
+	// Top of the stack of pending traces
+	std::atomic<Trace*> _pending;
+
+	// Number of traces submitted, and written
+	std::atomic<size_t> _submitted;
+	size_t _written;
+
+	// Guard _stop and _written, put the writer thread to sleep when
+	// there is nothing to write, and flushing threads till their
+	// traces are written.
+	std::mutex _mutex;
+	std::condition_variable _pending_cv;
+	std::condition_variable _written_cv;
+	bool _stop;
+
+	std::thread _writer;
+};
+
+} // ~namespace opencog
+
+#endif /* _OPENCOG_TRACE_WRITER_H_ */
@@ -41,16 +41,44 @@ const std::string UREConfig::jobs_name =
 	"URE:jobs";
 const std::string UREConfig::expansion_pool_size_name =
 	"URE:expansion-pool-size";
+const std::string UREConfig::max_wall_time_name =
+	"URE:maximum-wall-time";
+const std::string UREConfig::max_cpu_time_name =
+	"URE:maximum-cpu-time";
+const std::string UREConfig::max_pm_executions_name =
+	"URE:maximum-pm-executions";
+const std::string UREConfig::max_produced_atoms_name =
+	"URE:maximum-produced-atoms";
+const std::string UREConfig::random_seed_name =
+	"URE:random-seed";
 const std::string UREConfig::fc_retry_exhausted_sources_name =
 	"URE:FC:retry-exhausted-sources";
 const std::string UREConfig::fc_full_rule_application_name =
 	"URE:FC:full-rule-application";
+const std::string UREConfig::fc_semi_naive_name =
+	"URE:FC:semi-naive";
+const std::string UREConfig::fc_match_network_name =
+	"URE:FC:match-network";
+const std::string UREConfig::fc_source_selection_mode_name =
+	"URE:FC:source-selection-mode";
+const std::string UREConfig::fc_source_rule_selection_mode_name =
+	"URE:FC:source-rule-selection-mode";
+const std::string UREConfig::fc_tournament_size_name =
+	"URE:FC:tournament-size";
+const std::string UREConfig::fc_batch_size_name =
+	"URE:FC:batch-size";
+const std::string UREConfig::fc_inference_log_size_name =
+	"URE:FC:inference-log-size";
+const std::string UREConfig::fc_max_sources_name =
+	"URE:FC:maximum-sources";
 const std::string UREConfig::bc_max_bit_size_name =
 	"URE:BC:maximum-bit-size";
 const std::string UREConfig::bc_mm_complexity_penalty_name =
 	"URE:BC:MM:complexity-penalty";
 const std::string UREConfig::bc_mm_compressiveness_name =
 	"URE:BC:MM:compressiveness";
+const std::string UREConfig::bc_async_fulfillment_name =
+	"URE:BC:asynchronous-fulfillment";
 
 UREConfig::UREConfig(AtomSpace& as, const Handle& rbs) : _as(as)
 {
@@ -93,6 +121,31 @@ int UREConfig::get_expansion_pool_size() const
 	return _common_params.expansion_pool_size;
 }
 
+double UREConfig::get_maximum_wall_time() const
+{
+	return _common_params.max_wall_time;
+}
+
+double UREConfig::get_maximum_cpu_time() const
+{
+	return _common_params.max_cpu_time;
+}
+
+int UREConfig::get_maximum_pm_executions() const
+{
+	return _common_params.max_pm_executions;
+}
+
+int UREConfig::get_maximum_produced_atoms() const
+{
+	return _common_params.max_produced_atoms;
+}
+
+int UREConfig::get_random_seed() const
+{
+	return _common_params.random_seed;
+}
+
 bool UREConfig::get_retry_exhausted_sources() const
 {
 	return _fc_params.retry_exhausted_sources;
@@ -103,6 +156,46 @@ bool UREConfig::get_full_rule_application() const
 	return _fc_params.full_rule_application;
 }
 
+bool UREConfig::get_semi_naive() const
+{
+	return _fc_params.semi_naive;
+}
+
+bool UREConfig::get_match_network() const
+{
+	return _fc_params.match_network;
+}
+
+source_selection_mode UREConfig::get_source_selection_mode() const
+{
+	return _fc_params.source_selection;
+}
+
+source_rule_selection_mode UREConfig::get_source_rule_selection_mode() const
+{
+	return _fc_params.source_rule_selection;
+}
+
+int UREConfig::get_tournament_size() const
+{
+	return _fc_params.tournament_size;
+}
+
+int UREConfig::get_batch_size() const
+{
+	return _fc_params.batch_size;
+}
+
+int UREConfig::get_inference_log_size() const
+{
+	return _fc_params.inference_log_size;
+}
+
+int UREConfig::get_max_sources() const
+{
+	return _fc_params.max_sources;
+}
+
 double UREConfig::get_max_bit_size() const
 {
 	return _bc_params.max_bit_size;
@@ -118,6 +211,11 @@ double UREConfig::get_mm_compressiveness() const
 	return _bc_params.mm_compressiveness;
 }
 
+bool UREConfig::get_async_fulfillment() const
+{
+	return _bc_params.async_fulfillment;
+}
+
 std::string UREConfig::get_maximum_iterations_str() const
 {
 	if (_common_params.max_iter < 0)
@@ -145,6 +243,31 @@ void UREConfig::set_expansion_pool_size(int eps)
 	_common_params.expansion_pool_size = eps;
 }
 
+void UREConfig::set_maximum_wall_time(double mwt)
+{
+	_common_params.max_wall_time = mwt;
+}
+
+void UREConfig::set_maximum_cpu_time(double mct)
+{
+	_common_params.max_cpu_time = mct;
+}
+
+void UREConfig::set_maximum_pm_executions(int mpe)
+{
+	_common_params.max_pm_executions = mpe;
+}
+
+void UREConfig::set_maximum_produced_atoms(int mpa)
+{
+	_common_params.max_produced_atoms = mpa;
+}
+
+void UREConfig::set_random_seed(int rs)
+{
+	_common_params.random_seed = rs;
+}
+
 void UREConfig::set_retry_exhausted_sources(bool rs)
 {
 	_fc_params.retry_exhausted_sources = rs;
@@ -155,6 +278,51 @@ void UREConfig::set_full_rule_application(bool rs)
 	_fc_params.full_rule_application = rs;
 }
 
+void UREConfig::set_semi_naive(bool sn)
+{
+	_fc_params.semi_naive = sn;
+}
+
+void UREConfig::set_match_network(bool mn)
+{
+	_fc_params.match_network = mn;
+}
+
+void UREConfig::set_source_selection_mode(source_selection_mode ssm)
+{
+	_fc_params.source_selection = ssm;
+}
+
+void UREConfig::set_source_rule_selection_mode(source_rule_selection_mode srsm)
+{
+	_fc_params.source_rule_selection = srsm;
+}
+
+void UREConfig::set_tournament_size(int ts)
+{
+	_fc_params.tournament_size = ts;
+}
+
+void UREConfig::set_batch_size(int bs)
+{
+	_fc_params.batch_size = bs;
+}
+
+void UREConfig::set_inference_log_size(int ils)
+{
+	_fc_params.inference_log_size = ils;
+}
+
+void UREConfig::set_max_sources(int ms)
+{
+	_fc_params.max_sources = ms;
+}
+
+void UREConfig::set_max_bit_size(int mbs)
+{
+	_bc_params.max_bit_size = mbs;
+}
+
 void UREConfig::set_mm_complexity_penalty(double mm_cp)
 {
 	_bc_params.mm_complexity_penalty = mm_cp;
@@ -165,6 +333,11 @@ void UREConfig::set_mm_compressiveness(double mm_cpr)
 	_bc_params.mm_complexity_penalty = mm_cpr;
 }
 
+void UREConfig::set_async_fulfillment(bool af)
+{
+	_bc_params.async_fulfillment = af;
+}
+
 HandleSeq UREConfig::fetch_rule_names(const Handle& rbs)
 {
 	// Retrieve rules
@@ -209,6 +382,17 @@ void UREConfig::fetch_common_parameters(const Handle& rbs)
 	// Fetch production application ratio
 	_common_params.expansion_pool_size =
 		fetch_num_param(expansion_pool_size_name, rbs, 1);
+
+	// Fetch budget
+	_common_params.max_wall_time = fetch_num_param(max_wall_time_name, rbs, -1);
+	_common_params.max_cpu_time = fetch_num_param(max_cpu_time_name, rbs, -1);
+	_common_params.max_pm_executions =
+		fetch_num_param(max_pm_executions_name, rbs, -1);
+	_common_params.max_produced_atoms =
+		fetch_num_param(max_produced_atoms_name, rbs, -1);
+
+	// Fetch random seed
+	_common_params.random_seed = fetch_num_param(random_seed_name, rbs, -1);
 }
 
 void UREConfig::fetch_fc_parameters(const Handle& rbs)
@@ -218,6 +402,50 @@ void UREConfig::fetch_fc_parameters(const Handle& rbs)
 		fetch_bool_param(fc_retry_exhausted_sources_name, rbs, false);
 	_fc_params.full_rule_application =
 		fetch_bool_param(fc_full_rule_application_name, rbs, false);
+	_fc_params.semi_naive =
+		fetch_bool_param(fc_semi_naive_name, rbs, false);
+	_fc_params.match_network =
+		fetch_bool_param(fc_match_network_name, rbs, false);
+
+	// Fetch selection modes
+	std::string ssm =
+		fetch_concept_param(fc_source_selection_mode_name, rbs, "tv-fitness");
+	if (ssm == "tv-fitness")
+		_fc_params.source_selection = source_selection_mode::TV_FITNESS;
+	else if (ssm == "tournament")
+		_fc_params.source_selection = source_selection_mode::TOURNAMENT;
+	else if (ssm == "uniform")
+		_fc_params.source_selection = source_selection_mode::UNIFORM;
+	else
+		throw RuntimeException(TRACE_INFO,
+			"UREConfig - unknown source selection mode %s", ssm.c_str());
+
+	std::string srsm =
+		fetch_concept_param(fc_source_rule_selection_mode_name, rbs, "thompson");
+	if (srsm == "thompson")
+		_fc_params.source_rule_selection = source_rule_selection_mode::THOMPSON;
+	else if (srsm == "tv-fitness")
+		_fc_params.source_rule_selection = source_rule_selection_mode::TV_FITNESS;
+	else if (srsm == "tournament")
+		_fc_params.source_rule_selection = source_rule_selection_mode::TOURNAMENT;
+	else if (srsm == "uniform")
+		_fc_params.source_rule_selection = source_rule_selection_mode::UNIFORM;
+	else
+		throw RuntimeException(TRACE_INFO,
+			"UREConfig - unknown source rule selection mode %s", srsm.c_str());
+
+	// Fetch tournament size
+	_fc_params.tournament_size = fetch_num_param(fc_tournament_size_name, rbs, 2);
+
+	// Fetch batch size
+	_fc_params.batch_size = fetch_num_param(fc_batch_size_name, rbs, 1);
+
+	// Fetch inference log size
+	_fc_params.inference_log_size =
+		fetch_num_param(fc_inference_log_size_name, rbs, -1);
+
+	// Fetch maximum number of sources
+	_fc_params.max_sources = fetch_num_param(fc_max_sources_name, rbs, -1);
 }
 
 void UREConfig::fetch_bc_parameters(const Handle& rbs)
@@ -232,6 +460,10 @@ void UREConfig::fetch_bc_parameters(const Handle& rbs)
 	// Fetch BC Mixture Model compressiveness parameter
 	_bc_params.mm_compressiveness =
 		fetch_num_param(bc_mm_compressiveness_name, rbs, 1);
+
+	// Fetch BC asynchronous fulfillment parameter
+	_bc_params.async_fulfillment =
+		fetch_bool_param(bc_async_fulfillment_name, rbs, false);
 }
 
 HandleSeq UREConfig::fetch_execution_outputs(const Handle& schema,
@@ -299,6 +531,29 @@ double UREConfig::fetch_num_param(const string& schema_name,
 	return value;
 }
 
+std::string UREConfig::fetch_concept_param(const string& schema_name,
+                                           const Handle& input,
+                                           const std::string& default_value)
+{
+	Handle param_schema = _as.add_node(SCHEMA_NODE,
+	                                   std::move(std::string(schema_name)));
+	HandleSeq outputs = fetch_execution_outputs(param_schema, input, CONCEPT_NODE);
+
+	if (outputs.size() == 0) {
+		log_param_value(input, schema_name, default_value, true);
+		return default_value;
+	}
+
+	OC_ASSERT(outputs.size() == 1,
+	          "Could not retrieve parameter %s for rule-based system %s. "
+	          "There should be only one output, instead there are %u",
+	          schema_name.c_str(), input->get_name().c_str(), outputs.size());
+
+	std::string value = outputs.front()->get_name();
+	log_param_value(input, schema_name, value);
+	return value;
+}
+
 bool UREConfig::fetch_bool_param(const string& pred_name,
                                  const Handle& input,
                                  bool default_value)
@@ -32,6 +32,36 @@
 
 namespace opencog {
 
+/**
+ * Strategies of the forward chainer to select the next source to
+ * expand.
+ *
+ * TV_FITNESS: probability proportional to the source weight.
+ * TOURNAMENT: heaviest among k sources drawn uniformly.
+ * UNIFORM:    uniform over the sources that are not exhausted.
+ */
+enum class source_selection_mode
+{
+	TV_FITNESS, TOURNAMENT, UNIFORM
+};
+
+/**
+ * Strategies of the forward chainer to select the next source rule
+ * pair to apply from the expansion pool.
+ *
+ * THOMPSON:   Thompson sampling over the second order probabilities
+ *             of success.
+ * TV_FITNESS: probability proportional to the mean probability of
+ *             success.
+ * TOURNAMENT: highest mean probability of success among k pairs
+ *             drawn uniformly.
+ * UNIFORM:    uniform over all pairs.
+ */
+enum class source_rule_selection_mode
+{
+	THOMPSON, TV_FITNESS, TOURNAMENT, UNIFORM
+};
+
 /**
  * Read the URE configuration from the AtomSpace as described in
  * http://wiki.opencog.org/w/URE_Configuration_Format, and provide
@@ -64,13 +94,27 @@ public:
 	double get_complexity_penalty() const;
 	int get_jobs() const;
 	int get_expansion_pool_size() const;
+	double get_maximum_wall_time() const;
+	double get_maximum_cpu_time() const;
+	int get_maximum_pm_executions() const;
+	int get_maximum_produced_atoms() const;
+	int get_random_seed() const;
 	// FC
 	bool get_retry_exhausted_sources() const;
 	bool get_full_rule_application() const;
+	bool get_semi_naive() const;
+	bool get_match_network() const;
+	source_selection_mode get_source_selection_mode() const;
+	source_rule_selection_mode get_source_rule_selection_mode() const;
+	int get_tournament_size() const;
+	int get_batch_size() const;
+	int get_inference_log_size() const;
+	int get_max_sources() const;
 	// BC
 	double get_max_bit_size() const;
 	double get_mm_complexity_penalty() const;
 	double get_mm_compressiveness() const;
+	bool get_async_fulfillment() const;
 
 	// Display
 	std::string get_maximum_iterations_str() const; // "+inf" if negative
@@ -85,12 +129,27 @@ public:
 	void set_complexity_penalty(double);
 	void set_jobs(int);
 	void set_expansion_pool_size(int);
+	void set_maximum_wall_time(double);
+	void set_maximum_cpu_time(double);
+	void set_maximum_pm_executions(int);
+	void set_maximum_produced_atoms(int);
+	void set_random_seed(int);
 	// FC
 	void set_retry_exhausted_sources(bool);
 	void set_full_rule_application(bool);
+	void set_semi_naive(bool);
+	void set_match_network(bool);
+	void set_source_selection_mode(source_selection_mode);
+	void set_source_rule_selection_mode(source_rule_selection_mode);
+	void set_tournament_size(int);
+	void set_batch_size(int);
+	void set_inference_log_size(int);
+	void set_max_sources(int);
 	// BC
+	void set_max_bit_size(int);
 	void set_mm_complexity_penalty(double);
 	void set_mm_compressiveness(double);
+	void set_async_fulfillment(bool);
 
 	//////////////////
 	// Constants    //
@@ -114,6 +173,15 @@ public:
 	// Name of the production application ratio parameter
 	static const std::string expansion_pool_size_name;
 
+	// Names of the budget parameters, see Budget
+	static const std::string max_wall_time_name;
+	static const std::string max_cpu_time_name;
+	static const std::string max_pm_executions_name;
+	static const std::string max_produced_atoms_name;
+
+	// Name of the random seed parameter
+	static const std::string random_seed_name;
+
 	// Name of the PredicateNode outputting whether sources should be
 	// retried after exhaustion
 	static const std::string fc_retry_exhausted_sources_name;
@@ -123,6 +191,40 @@ public:
 	// source.
 	static const std::string fc_full_rule_application_name;
 
+	// Name of the PredicateNode outputting whether rules applied over
+	// the entire atomspace should only be matched against atoms
+	// produced since their last application.
+	static const std::string fc_semi_naive_name;
+
+	// Name of the PredicateNode outputting whether source rule pairs
+	// should be produced incrementally by the alpha network, a type
+	// and arity prefilter of the rules applicable to new sources.
+	static const std::string fc_match_network_name;
+
+	// Name of the SchemaNode outputting the source selection mode,
+	// as a ConceptNode among "tv-fitness", "tournament" and "uniform".
+	static const std::string fc_source_selection_mode_name;
+
+	// Name of the SchemaNode outputting the source rule pair
+	// selection mode, as a ConceptNode among "thompson",
+	// "tv-fitness", "tournament" and "uniform".
+	static const std::string fc_source_rule_selection_mode_name;
+
+	// Name of the tournament size parameter, used by the tournament
+	// selection modes.
+	static const std::string fc_tournament_size_name;
+
+	// Name of the batch size parameter, the maximum number of source
+	// rule pairs sharing the same base rule applied per iteration.
+	static const std::string fc_batch_size_name;
+
+	// Name of the inference log size parameter, the maximum number of
+	// inference records retained per thread.
+	static const std::string fc_inference_log_size_name;
+
+	// Name of the maximum number of sources parameter
+	static const std::string fc_max_sources_name;
+
 	// Name of the maximum number of and-BITs in the BIT parameter
 	static const std::string bc_max_bit_size_name;
 
@@ -134,6 +236,10 @@ public:
 	// much unexplained data are compressed
 	static const std::string bc_mm_compressiveness_name;
 
+	// Name of the PredicateNode outputting whether and-BITs should be
+	// fulfilled asynchronously, while the BIT keeps being expanded.
+	static const std::string bc_async_fulfillment_name;
+
 private:
 	AtomSpace& _as;
 
@@ -160,6 +266,19 @@ private:
 		// iterative forward chainer), but also then the selection is
 		// more costly. Negative means unlimited.
 		int expansion_pool_size;
+
+		// Budget of the chainer. Reasoning stops, returning the
+		// results found so far, when any of these is reached. Times
+		// are in seconds. Negative means unlimited.
+		double max_wall_time;
+		double max_cpu_time;
+		int max_pm_executions;
+		int max_produced_atoms;
+
+		// Seed of the random draws of the chainer. Given a seed and
+		// a number of jobs of 1, chaining is reproducible. Negative
+		// means drawn from the global random generator.
+		int random_seed;
 	};
 	CommonParameters _common_params;
 
@@ -171,7 +290,43 @@ private:
 		// Apply the selected rule over the entire atomspace, not just
 		// the selected source.
 		bool full_rule_application;
-};
+
+		// Semi-naive evaluation. When a rule is applied over the
+		// entire atomspace (full rule application or no source), only
+		// enumerate groundings where at least one premise matches an
+		// atom produced since the last application of that rule.
+		bool semi_naive;
+
+		// Produce source rule pairs incrementally with a match
+		// network, as sources are produced, rather than by
+		// selecting sources and unifying them with all rules.
+		bool match_network;
+
+		// How to select sources and source rule pairs. These trade
+		// search quality for lower selection cost, which matters on
+		// large populations of sources or expansion pools.
+		source_selection_mode source_selection;
+		source_rule_selection_mode source_rule_selection;
+
+		// Number of candidates drawn by tournament selection
+		int tournament_size;
+
+		// Maximum number of source rule pairs with the same base rule
+		// applied together per iteration. Amortizes the setup cost of
+		// rule application when the expansion pool is large. 1 means
+		// no batching.
+		int batch_size;
+
+		// Maximum number of inference records retained per thread,
+		// the oldest being discarded first. Products are retained
+		// regardless. Negative means unlimited.
+		int inference_log_size;
+
+		// Maximum number of sources in the population. When
+		// exceeded, the least promising sources are evicted.
+		// Negative means unlimited.
+		int max_sources;
+	};
 	FCParameters _fc_params;
 
 	// Parameter specific to the backward chainer.
@@ -191,6 +346,10 @@ private:
 		// unexplained data are compressed. The compressed unexplained
 		// data are added to the model complexity.
 		double mm_compressiveness;
+
+		// Fulfill expanded and-BITs in background workers, in order
+		// of fitness, rather than right after their expansion.
+		bool async_fulfillment;
 	};
 	BCParameters _bc_params;
 
@@ -246,6 +405,12 @@ private:
 	                       const Handle& input,
 	                       double default_value=0.0);
 
+	// Similar to fetch_num_param but assumes that the output value
+	// is a ConceptNode, and return its name.
+	std::string fetch_concept_param(const std::string& schema_name,
+	                                const Handle& input,
+	                                const std::string& default_value);
+
 	// Given <pred_name> and <input> in
 	//
 	// EvaluationLink TV
@@ -0,0 +1,51 @@
+/*
+ * URERandom.cc
+ *
+ * Copyright (C) 2020 SingularityNET Foundation
+ *
+ * Authors: Nil Geisweiller
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License v3 as
+ * published by the Free Software Foundation and including the exceptions
+ * at http://opencog.org/wiki/Licenses
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program; if not, write to:
+ * Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include <cstdint>
+
+#include "URERandom.h"
+
+namespace opencog {
+
+unsigned long ure_seed(const UREConfig& config)
+{
+	int seed = config.get_random_seed();
+	return 0 <= seed ? seed : randGen()();
+}
+
+// SplitMix64 finalizer, so that consecutive inputs are mapped to
+// well spread outputs.
+static uint64_t mix(uint64_t x)
+{
+	x += 0x9e3779b97f4a7c15ULL;
+	x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+	x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+	return x ^ (x >> 31);
+}
+
+RandGen ure_substream(unsigned long seed, unsigned long index)
+{
+	return RandGen(mix(mix(seed) ^ index));
+}
+
+} // ~namespace opencog
@@ -0,0 +1,54 @@
+/*
+ * URERandom.h
+ *
+ * Copyright (C) 2020 SingularityNET Foundation
+ *
+ * Authors: Nil Geisweiller
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License v3 as
+ * published by the Free Software Foundation and including the exceptions
+ * at http://opencog.org/wiki/Licenses
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program; if not, write to:
+ * Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+#ifndef _OPENCOG_URE_RANDOM_H_
+#define _OPENCOG_URE_RANDOM_H_
+
+#include <opencog/util/mt19937ar.h>
+
+#include "UREConfig.h"
+
+namespace opencog
+{
+
+/**
+ * Return the seed of a chainer, the random seed parameter if
+ * non-negative, otherwise a seed drawn from randGen(), so that
+ * seeding randGen() keeps making chainers reproducible.
+ */
+unsigned long ure_seed(const UREConfig& config);
+
+/**
+ * Return a generator of the substream of the given index, for
+ * instance an iteration, of a chainer seeded with seed. The seeds
+ * of the substreams are obtained by mixing seed and index, so that
+ * different indices yield independent looking streams.
+ *
+ * Drawing from the substream of an iteration, rather than from a
+ * shared generator, makes the draws of that iteration independent of
+ * the thread running it and of the other iterations.
+ */
+RandGen ure_substream(unsigned long seed, unsigned long index);
+
+} // ~namespace opencog
+
+#endif /* _OPENCOG_URE_RANDOM_H_ */
@@ -20,11 +20,11 @@
  * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
  */
 
+#include <random>
+
 #include <boost/range/algorithm/binary_search.hpp>
-#include <boost/range/algorithm/lower_bound.hpp>
 #include <boost/range/algorithm/reverse.hpp>
 #include <boost/range/algorithm/unique.hpp>
-#include <boost/range/algorithm/find.hpp>
 #include <boost/range/algorithm/sort.hpp>
 #include <boost/range/algorithm_ext/erase.hpp>
 #include <boost/algorithm/cxx11/all_of.hpp>
@@ -36,6 +36,7 @@
 
 #include <opencog/util/random.h>
 #include <opencog/util/algorithm.h>
+#include <opencog/util/oc_assert.h>
 #include <opencog/atoms/core/FindUtils.h>
 #include <opencog/atoms/core/TypeUtils.h>
 #include <opencog/atoms/grounded/LibraryManager.h>
@@ -87,11 +88,12 @@ std::string	BITNode::to_string(const std::string& indent) const
 // AndBIT //
 ////////////
 
-AndBIT::AndBIT() : complexity(0), exhausted(false), queried_as(nullptr) {}
+AndBIT::AndBIT()
+	: complexity(0), exhausted(false), queried_as(nullptr), id(-1) {}
 
 AndBIT::AndBIT(AtomSpace& bit_as, const Handle& target, Handle vardecl,
                const BITNodeFitness& fitness, const AtomSpace* qas)
-	: exhausted(false), queried_as(qas)
+	: exhausted(false), queried_as(qas), id(-1)
 {
 	// in case it is undefined
 	if (nullptr == vardecl)
@@ -115,7 +117,7 @@ AndBIT::AndBIT(AtomSpace& bit_as, const Handle& target, Handle vardecl,
 }
 
 AndBIT::AndBIT(const Handle& f, double cpx, const AtomSpace* qas)
-	: fcs(f), complexity(cpx), exhausted(false), queried_as(qas)
+	: fcs(f), complexity(cpx), exhausted(false), queried_as(qas), id(-1)
 {
 	set_leaf2bitnode();         // TODO: might differ till needed to optimize
 }
@@ -148,7 +150,7 @@ AndBIT AndBIT::expand(const Handle& leaf,
 	return AndBIT(new_fcs, new_cpx, queried_as);
 }
 
-BITNode* AndBIT::select_leaf()
+BITNode* AndBIT::select_leaf(RandGen& rng)
 {
 	// Generate the distribution over target leaves according to the
 	// BIT-node fitnesses. The higher the fitness the lower the chance
@@ -167,7 +169,7 @@ BITNode* AndBIT::select_leaf()
 
 	// If well defined then sample according to it
 	LeafDistribution dist(weights.begin(), weights.end());
-	return &rand_element(leaf2bitnode, dist).second;
+	return &std::next(leaf2bitnode.begin(), dist(rng))->second;
 }
 
 void AndBIT::reset_exhausted()
@@ -756,59 +758,207 @@ size_t BIT::size() const
 
 AndBIT* BIT::init()
 {
-	andbits.emplace_back(bit_as, _init_target,
-	                     _init_vardecl, _init_fitness, _as);
+	AndBIT* andbit = insert(AndBIT(bit_as, _init_target,
+	                               _init_vardecl, _init_fitness, _as));
 
 	LAZY_URE_LOG_DEBUG << "Initialize BIT with:" << std::endl
-	                   << andbits.begin()->to_string();
+	                   << andbit->to_string();
 
-	return &*andbits.begin();
+	return andbit;
 }
 
 AndBIT* BIT::expand(AndBIT& andbit, BITNode& bitleaf,
                     const RuleTypedSubstitutionPair& rule, double prob)
+{
+	// Expand the and-BIT and insert it in the BIT, if the expansion
+	// was successful
+	AndBIT new_andbit = expansion(andbit, bitleaf, rule, prob);
+	return (bool)new_andbit.fcs ? insert(std::move(new_andbit)) : nullptr;
+}
+
+AndBIT BIT::expansion(AndBIT& andbit, BITNode& bitleaf,
+                      const RuleTypedSubstitutionPair& rule,
+                      double prob) const
 {
 	// Make sure that the rule is not already an or-child of bitleaf.
 	if (is_in(rule, bitleaf)) {
 		ure_logger().debug() << "An equivalent rule has already expanded "
 		                     << "that BIT-node, abort expansion";
-		return nullptr;
+		return AndBIT();
 	}
 
 	// Insert the rule as or-branch of this bitleaf
 	bitleaf.rules.insert(rule);
 
-	// Expand the and-BIT and insert it in the BIT, if the expansion
-	// was successful
-	AndBIT new_andbit = andbit.expand(bitleaf.body, rule, prob);
-	return (bool)new_andbit.fcs ? insert(new_andbit) : nullptr;
+	return andbit.expand(bitleaf.body, rule, prob);
 }
 
-AndBIT* BIT::insert(AndBIT& andbit)
+AndBIT* BIT::insert(AndBIT andbit)
 {
 	// Check that it isn't already in the BIT
-	if (boost::find(andbits, andbit) != andbits.end()) {
+	if (_andbit_fcss.find(andbit.fcs) != _andbit_fcss.end()) {
 		LAZY_URE_LOG_DEBUG << "The following and-BIT is already in the BIT: "
 		                   << andbit.fcs->id_to_string();
 		return nullptr;
 	}
-	// Insert while keeping the order
-	auto it = andbits.insert(boost::lower_bound(andbits, andbit), andbit);
+
+	// Move it to a free slot if any, otherwise to a new one
+	size_t id;
+	if (_free_ids.empty()) {
+		id = _slab.size();
+		_slab.push_back(std::move(andbit));
+		_weights.push_back(0.0);
+	} else {
+		id = _free_ids.back();
+		_free_ids.pop_back();
+		_slab[id] = std::move(andbit);
+	}
+	AndBIT* new_andbit = &_slab[id];
+	new_andbit->id = id;
+
+	// Index it, while keeping the order, and cache its weight
+	andbits.insert(new_andbit);
+	_andbit_fcss.insert(new_andbit->fcs);
+	update_weight(*new_andbit);
 
 	// Return andbit pointer
-	return &*it;
+	return new_andbit;
+}
+
+AndBIT& BIT::get_andbit(size_t id)
+{
+	OC_ASSERT(id < _slab.size() and _slab[id].fcs);
+	return _slab[id];
+}
+
+BIT::AndBITs::iterator BIT::erase(AndBITs::const_iterator pos)
+{
+	AndBIT* andbit = *pos;
+	AndBITs::iterator next = andbits.erase(pos);
+	remove_hypergraph(bit_as, release(*andbit));
+	return next;
+}
+
+void BIT::erase(const std::vector<AndBIT*>& to_erase)
+{
+	HandleSeq fcss;
+	for (AndBIT* andbit : to_erase) {
+		andbits.erase(andbit);
+		fcss.push_back(release(*andbit));
+	}
+
+	// Order the atoms of the FCS sub-hypergraphs so that each link
+	// comes before its outgoing atoms (reverse post-order), then
+	// extract them bottom-up in a single sweep. Atoms still referred
+	// to, by the kept FCS or by links that could not be extracted,
+	// fail to be extracted and are left in bit_as.
+	HandleSeq post_order;
+	HandleSet visited;
+	std::function<void(const Handle&)> visit = [&](const Handle& h) {
+		if (not visited.insert(h).second)
+			return;
+		if (h->is_link())
+			for (const Handle& oh : h->getOutgoingSet())
+				visit(oh);
+		post_order.push_back(h);
+	};
+	for (const Handle& fcs : fcss)
+		visit(fcs);
+	for (auto it = post_order.rbegin(); it != post_order.rend(); ++it)
+		bit_as.extract_atom(*it);
+}
+
+Handle BIT::release(AndBIT& andbit)
+{
+	Handle fcs = andbit.fcs;
+	_andbit_fcss.erase(fcs);
+	_weights.set(andbit.id, 0.0);
+	_free_ids.push_back(andbit.id);
+
+	// Clear the slot, to free its BIT-nodes
+	andbit = AndBIT();
+	return fcs;
+}
+
+void BIT::set_weight(const std::function<double(const AndBIT&)>& weight)
+{
+	_weight = weight;
+	update_weights();
+}
+
+void BIT::update_weights()
+{
+	for (const AndBIT* andbit : andbits)
+		update_weight(*andbit);
+}
+
+void BIT::update_weight(const AndBIT& andbit)
+{
+	_weights.set(andbit.id, _weight ? _weight(andbit) : 1.0);
+}
+
+double BIT::get_weight(const AndBIT& andbit) const
+{
+	return _weights.get(andbit.id);
+}
+
+AndBIT* BIT::sample(RandGen& rng)
+{
+	if (andbits.empty())
+		return nullptr;
+	if (_weights.total() <= 0.0)
+		return uniform_sample(rng);
+	return &_slab[_weights(rng)];
+}
+
+std::vector<AndBIT*> BIT::sample(size_t n, RandGen& rng)
+{
+	std::vector<AndBIT*> sampled;
+	std::vector<std::pair<size_t, double>> removed;
+	while (sampled.size() < n and not andbits.empty()) {
+		if (_weights.total() <= 0.0) {
+			if (sampled.empty())
+				sampled.push_back(uniform_sample(rng));
+			break;
+		}
+
+		// Null the weight of the sampled and-BIT till the end, so
+		// that it is not sampled again.
+		size_t id = _weights(rng);
+		sampled.push_back(&_slab[id]);
+		removed.emplace_back(id, _weights.get(id));
+		_weights.set(id, 0.0);
+	}
+
+	// Restore the weights of the sampled and-BITs
+	for (const auto& iw : removed)
+		_weights.set(iw.first, iw.second);
+
+	return sampled;
+}
+
+AndBIT* BIT::uniform_sample(RandGen& rng)
+{
+	std::uniform_int_distribution<size_t> dist(0, andbits.size() - 1);
+	return *std::next(andbits.begin(), dist(rng));
+}
+
+bool BIT::andbit_ptr_less::operator()(const AndBIT* l, const AndBIT* r) const
+{
+	return *l < *r;
 }
 
 void BIT::reset_exhausted_flags()
 {
-	for (AndBIT& andbit : andbits)
-		andbit.reset_exhausted();
+	for (AndBIT* andbit : andbits)
+		andbit->reset_exhausted();
+	update_weights();
 }
 
 bool BIT::andbits_exhausted() const
 {
-	return boost::algorithm::all_of(andbits, [](const AndBIT& andbit) {
-			return andbit.exhausted; });
+	return boost::algorithm::all_of(andbits, [](const AndBIT* andbit) {
+			return andbit->exhausted; });
 }
 
 bool BIT::is_in(const RuleTypedSubstitutionPair& rule,
@@ -23,10 +23,16 @@
 #ifndef _OPENCOG_BIT_H
 #define _OPENCOG_BIT_H
 
+#include <deque>
+#include <functional>
+#include <set>
+
 #include <boost/operators.hpp>
 
 #include <opencog/util/empty_string.h>
+#include <opencog/util/mt19937ar.h>
 #include <opencog/ure/Rule.h>
+#include <opencog/ure/SumTree.h>
 #include <opencog/atoms/base/Handle.h>
 #include <opencog/atomspaceutils/AtomSpaceUtils.h>
 #include "Fitness.h"
@@ -98,6 +104,10 @@ public:
 	// Queried atomspace
 	const AtomSpace* queried_as;
 
+	// Compact id of the and-BIT in the BIT holding it, that is the
+	// index of its slot in the BIT storage. -1 if not in a BIT.
+	size_t id;
+
 	/**
 	 * @brief Initialize an and-BIT with a certain target, vardecl and
 	 * fitness and add it in bit_as. If an extra atomspace queried_as
@@ -114,8 +124,13 @@ public:
 	 */
 	AndBIT(const Handle& fcs, double complexity=0.0,
 	       const AtomSpace* queried_as=nullptr);
+	AndBIT(const AndBIT&) = default;
+	AndBIT(AndBIT&&) = default;
 	~AndBIT();
 
+	AndBIT& operator=(const AndBIT&) = default;
+	AndBIT& operator=(AndBIT&&) = default;
+
 	/**
 	 * @brief Expand the and-BIT given a target leaf and rule.
 	 *
@@ -138,7 +153,7 @@ public:
 	 *
 	 * @return The selected leaf.
 	 */
-	BITNode* select_leaf();
+	BITNode* select_leaf(RandGen& rng=randGen());
 
 	/**
 	 * Set the and-BIT exhausted flags to false. Take care of the
@@ -416,11 +431,20 @@ public:
 	// Child atomspace of the queried atomspace for storing the BIT
 	AtomSpace bit_as;
 
-	// Collection of and-BITs. We use a sorted vector instead of a set
-	// because the andbit being expanded is modified (its expanded
-	// bit-Node keeps track of the expansion). Alternatively we could
-	// use a set and define AndBIT::leaf2bitnode as mutable.
-	typedef std::vector<AndBIT> AndBITs;
+	// Order of and-BITs, by complexity then content, see
+	// AndBIT::operator<
+	struct andbit_ptr_less
+	{
+		bool operator()(const AndBIT* l, const AndBIT* r) const;
+	};
+
+	// Collection of and-BITs, sorted by complexity then content. The
+	// and-BITs themselves are stored in a slab, see _slab, this is
+	// only an index over them, so that the and-BITs can be modified
+	// (the expanded bit-Node keeps track of the expansion) and are
+	// never moved, thus pointers to them and their BIT-nodes remain
+	// valid till they are erased.
+	typedef std::set<AndBIT*, andbit_ptr_less> AndBITs;
 	AndBITs andbits;
 
 	/**
@@ -459,21 +483,89 @@ public:
 	               double prob=1.0);
 
 	/**
-	 * Insert a new andbit in the BIT and return its pointer, nullptr
-	 * if not inserted (which may happen if an equivalent one is
-	 * already in it). Warning: the reference on andbit will likely be
-	 * invalid after this call because the container is modified.
+	 * Like expand but return the expanded and-BIT without inserting
+	 * it in the BIT. Its FCS is undefined if the expansion has
+	 * failed.
+	 *
+	 * As the BIT is left unchanged, this may be called concurrently
+	 * over distinct and-BITs, the results being inserted afterwards.
+	 */
+	AndBIT expansion(AndBIT& andbit, BITNode& bitleaf,
+	                 const RuleTypedSubstitutionPair& rule,
+	                 double prob=1.0) const;
+
+	/**
+	 * Insert andbit in the BIT, assign its id and return its pointer,
+	 * nullptr if not inserted (which happens if an and-BIT with the
+	 * same FCS is already in it). Duplicates are detected in O(1),
+	 * and the and-BIT is indexed in O(log n). Pass an rvalue to move
+	 * it, along with its BIT-nodes, rather than copy it.
+	 */
+	AndBIT* insert(AndBIT andbit);
+
+	/**
+	 * Return the and-BIT of the given id, which must be in the BIT.
 	 */
-	AndBIT* insert(AndBIT& andbit);
+	AndBIT& get_andbit(size_t id);
 
 	/**
 	 * Erase the given and-BIT from the BIT and remove its FCS from
 	 * bit_as.
 	 */
-	template<typename It> AndBITs::iterator erase(It pos);
+	AndBITs::iterator erase(AndBITs::const_iterator pos);
 
 	/**
-	 * Reset to false all and-BITs exhausted flags.
+	 * Erase the given and-BITs from the BIT, then remove their FCS
+	 * from bit_as in a single sweep over the union of their
+	 * sub-hypergraphs, sub-hypergraphs shared with remaining FCS
+	 * being kept.
+	 */
+	void erase(const std::vector<AndBIT*>& to_erase);
+
+	/**
+	 * Set the function returning the selection weight of an and-BIT,
+	 * and recompute the weights of all and-BITs.
+	 *
+	 * Weights are cached in a sum tree so that sampling an and-BIT
+	 * and updating its weight are O(log n). The weight of an and-BIT
+	 * is computed when it is inserted, and must be updated, with
+	 * update_weight, whenever the and-BIT changes in a way that
+	 * affects it, such as being exhausted. By default all weights
+	 * are 1.
+	 */
+	void set_weight(const std::function<double(const AndBIT&)>& weight);
+
+	/**
+	 * Recompute the weights of all and-BITs, or of the given one,
+	 * which must be in the BIT.
+	 */
+	void update_weights();
+	void update_weight(const AndBIT& andbit);
+
+	/**
+	 * Return the cached weight of the given and-BIT, which must be in
+	 * the BIT.
+	 */
+	double get_weight(const AndBIT& andbit) const;
+
+	/**
+	 * Sample an and-BIT with probability proportional to its weight,
+	 * uniformly if all weights are null. Return nullptr if the BIT is
+	 * empty.
+	 */
+	AndBIT* sample(RandGen& rng=randGen());
+
+	/**
+	 * Sample up to n distinct and-BITs, without replacement. Sampling
+	 * stops once all remaining and-BITs have null weights, unless
+	 * none has been sampled yet, in which case one is sampled
+	 * uniformly.
+	 */
+	std::vector<AndBIT*> sample(size_t n, RandGen& rng=randGen());
+
+	/**
+	 * Reset to false all and-BITs exhausted flags, and update their
+	 * weights accordingly.
 	 */
 	void reset_exhausted_flags();
 
@@ -496,14 +588,31 @@ private:
 	Handle _init_target;
 	Handle _init_vardecl;
 	BITNodeFitness _init_fitness;
-};
 
-template<typename It>
-BIT::AndBITs::iterator BIT::erase(It pos)
-{
-	remove_hypergraph(bit_as, pos->fcs);
-	return andbits.erase(pos);
-}
+	// Storage of the and-BITs, the slot of an and-BIT being its
+	// id. A deque never moves its elements when growing. Slots of
+	// erased and-BITs are cleared and reused by the next insertions,
+	// so that ids remain compact.
+	std::deque<AndBIT> _slab;
+	std::vector<size_t> _free_ids;
+
+	// FCS of the and-BITs, to detect duplicates without scanning.
+	HandleSet _andbit_fcss;
+
+	// Selection weight function, see set_weight
+	std::function<double(const AndBIT&)> _weight;
+
+	// Cached weights of the and-BITs, indexed by id. Free slots have
+	// null weights.
+	SumTree _weights;
+
+	// Remove an and-BIT, already erased from andbits, from the other
+	// indices and free its slot. Return its FCS.
+	Handle release(AndBIT& andbit);
+
+	// Uniformly sample an and-BIT, O(n)
+	AndBIT* uniform_sample(RandGen& rng);
+};
 
 // Gdb debugging, see
 // http://wiki.opencog.org/w/Development_standards#Print_OpenCog_Objects
@@ -23,11 +23,15 @@
  * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
  */
 
+#include <algorithm>
+#include <numeric>
+
 #include <opencog/util/random.h>
 
 #include <opencog/unify/Unify.h>
 
 #include "BackwardChainer.h"
+#include "../SumTree.h"
 #include "../URELogger.h"
 
 using namespace opencog;
@@ -47,16 +51,24 @@ BackwardChainer::BackwardChainer(AtomSpace& kb_as,
 	: _kb_as(kb_as),
 	  _rb_as(rb_as),
 	  _config(_rb_as, rbs),
+	  _budget(_config),
 	  _bit(kb_as, target, vardecl, bitnode_fitness),
 	  _andbit_fitness(andbit_fitness),
 	  _trace_recorder(trace_as),
 	  _control(_config, _bit, target, control_as),
 	  _rules(_control.rules),
 	  _iteration(0),
-	  _last_expansion_andbit(nullptr)
+	  _seed(0),
+	  _rng(0),
+	  _last_expansion_andbit(nullptr),
+	  _queued_fcs_count(0),
+	  _meta_rules_expanded(false)
 {
 	// Record the target in the trace atomspace
 	_trace_recorder.target(target);
+
+	// Cache the expansion weights of the and-BITs in the BIT
+	_bit.set_weight([this](const AndBIT& andbit) { return operator()(andbit); });
 }
 
 BackwardChainer::BackwardChainer(AtomSpace& kb_as,
@@ -90,11 +102,25 @@ void BackwardChainer::do_chain()
 	ure_logger().debug("Start backward chaining");
 	LAZY_URE_LOG_DEBUG << "With rule set:" << std::endl << oc_to_string(_rules);
 
+	_budget.start();
+	_seed = ure_seed(_config);
+
+	// The complexity penalty may have changed since the weights were
+	// cached
+	_bit.update_weights();
+	LAZY_URE_LOG_DEBUG << "Random seed: " << _seed;
+
 	while (not termination())
 	{
 		do_step();
 	}
 
+	// Make sure all expanded and-BITs have been fulfilled
+	wait_fulfillments();
+
+	// Make sure the traces are in the trace atomspace
+	_trace_recorder.flush();
+
 	LAZY_URE_LOG_DEBUG << "Finished backward chaining with results:"
 	                   << std::endl << oc_to_string(get_results_set());
 }
@@ -103,11 +129,18 @@ void BackwardChainer::do_step()
 {
 	_iteration++;
 
+	// Draw from the substream of that iteration
+	_rng = ure_substream(_seed, _iteration);
+
 	ure_logger().debug() << "Iteration " << _iteration
 	                     << "/" << _config.get_maximum_iterations_str();
 
-	expand_bit();
-	fulfill_bit();
+	if (1 < _config.get_jobs() and not _bit.empty()) {
+		expand_fulfill_bit_parallel();
+	} else {
+		expand_bit();
+		fulfill_bit();
+	}
 	reduce_bit();
 }
 
@@ -124,6 +157,10 @@ bool BackwardChainer::termination()
 		msg = "all AndBITS are exhausted";
 		terminate = true;
 	}
+	else if (_budget.is_exhausted()) {
+		msg = _budget.exhausted_msg();
+		terminate = true;
+	}
 
 	if (terminate)
 		ure_logger().debug() << "Terminate: " << msg;
@@ -144,10 +181,30 @@ const HandleSet& BackwardChainer::get_results_set() const
 
 void BackwardChainer::expand_meta_rules()
 {
+	// Claim the atoms added by fulfillment since the last expansion
+	HandleSet new_atoms;
+	{
+		std::lock_guard<std::mutex> lock(_meta_rules_mutex);
+		new_atoms.swap(_meta_rules_delta);
+	}
+	if (not _rules.has_meta_rules())
+		return;
+
+	// The first expansion goes over the whole knowledge base, the
+	// subsequent ones only over the new atoms, which are rare during
+	// backward chaining as the BIT lives in its own atomspace.
+	bool first = not _meta_rules_expanded;
+	if (not first and new_atoms.empty())
+		return;
+
 	// This is kinda of hack before meta rules are fully supported by
 	// the Rule class.
 	size_t rules_size = _rules.size();
-	_rules.expand_meta_rules(_kb_as);
+	if (first)
+		_rules.expand_meta_rules(_kb_as);
+	else
+		_rules.expand_meta_rules(_kb_as, new_atoms);
+	_meta_rules_expanded = true;
 
 	// If the rule set has changed we need to reset the exhausted
 	// flags.
@@ -182,8 +239,21 @@ void BackwardChainer::expand_bit()
 
 void BackwardChainer::expand_bit(AndBIT& andbit)
 {
+	Expansion exp = expansion(andbit, _rng);
+
+	// andbit may have been exhausted
+	_bit.update_weight(andbit);
+
+	_last_expansion_andbit = insert_expansion(exp);
+}
+
+BackwardChainer::Expansion BackwardChainer::expansion(AndBIT& andbit,
+                                                      RandGen& rng)
+{
+	Expansion exp;
+
 	// Select leaf
-	BITNode* bitleaf = andbit.select_leaf();
+	BITNode* bitleaf = andbit.select_leaf(rng);
 	if (bitleaf) {
 		LAZY_URE_LOG_DEBUG << "Selected BIT-node for expansion:" << std::endl
 		                   << bitleaf->to_string();
@@ -191,11 +261,11 @@ void BackwardChainer::expand_bit(AndBIT& andbit)
 		ure_logger().debug() << "All BIT-nodes of this and-BIT are exhausted "
 		                     << "(or possibly fulfilled). Abort expansion.";
 		andbit.exhausted = true;
-		return;
+		return exp;
 	}
 
 	// Select rule for expansion
-	RuleSelection rule_sel = _control.select_rule(andbit, *bitleaf);
+	RuleSelection rule_sel = _control.select_rule(andbit, *bitleaf, rng);
 	Rule rule(rule_sel.first.first);
 	Unify::TypedSubstitution ts(rule_sel.first.second);
 	double prob(rule_sel.second);
@@ -208,33 +278,109 @@ void BackwardChainer::expand_bit(AndBIT& andbit)
 	if (not rule.is_valid()) {
 		ure_logger().debug("No valid rule for the selected BIT-node, "
 		                   "abort expansion");
-		return;
+		return exp;
 	} else if (rule.has_cycle()) {
 		LAZY_URE_LOG_DEBUG << "The following rule has cycle (some premise "
 		                   << "equals to conclusion), abort expansion:"
 		                   << std::endl << rule.to_string();
-		return;
+		return exp;
 	}
 
 	// Rule seems well, expand
 	LAZY_URE_LOG_DEBUG << "Selected rule, with probability " << prob
 	                   << " of success:" << std::endl << rule.to_string();
 
-	// Expand andbit. Warning: after this call the reference on andbit
-	// and bitleaf may no longer be valid because the container of
-	// and-BITs might have been resorted. so we keep track of their
-	// bodies for future use.
-	Handle andbit_fcs = andbit.fcs;
-	Handle bitleaf_body = bitleaf->body;
+	// Expand andbit. Keep track of andbit and bitleaf to record the
+	// expansion once inserted, their addresses are stable.
+	exp.andbit = &andbit;
+	exp.bitleaf = bitleaf;
+	exp.rule = rule;
 	RuleTypedSubstitutionPair rtsp{rule, ts};
-	_last_expansion_andbit = _bit.expand(andbit, *bitleaf, rtsp, prob);
+	exp.expanded = _bit.expansion(andbit, *bitleaf, rtsp, prob);
+	return exp;
+}
+
+const AndBIT* BackwardChainer::insert_expansion(Expansion& exp)
+{
+	if (not exp.expanded.fcs)
+		return nullptr;
+
+	const AndBIT* andbit = _bit.insert(std::move(exp.expanded));
 
 	// Record the expansion in the trace atomspace
-	if (_last_expansion_andbit) {
-		_trace_recorder.andbit(*_last_expansion_andbit);
-		_trace_recorder.expansion(andbit_fcs, bitleaf_body,
-		                          rule, *_last_expansion_andbit);
+	if (andbit) {
+		_trace_recorder.andbit(*andbit);
+		_trace_recorder.expansion(exp.andbit->fcs, exp.bitleaf->body,
+		                          exp.rule, *andbit);
+	}
+	return andbit;
+}
+
+void BackwardChainer::expand_fulfill_bit_parallel()
+{
+	// Expand meta rules, before they are fully supported
+	expand_meta_rules();
+
+	// Fulfillment is done here, on all expanded and-BITs
+	_last_expansion_andbit = nullptr;
+
+	// Select distinct and-BITs, so that concurrent expansions modify
+	// distinct BIT-nodes.
+	std::vector<AndBIT*> andbits = select_expansion_andbits(_config.get_jobs());
+	LAZY_URE_LOG_DEBUG << "Selected " << andbits.size()
+	                   << " and-BITs for parallel expansion";
+
+	// Expand them in parallel. Each expansion draws from its own
+	// substream so that the selections do not depend on the
+	// scheduling. The BIT is left unchanged till all expansions are
+	// done, thus the and-BIT pointers remain valid.
+	ThreadPool& pool = get_thread_pool();
+	std::vector<std::future<Expansion>> expansion_futures;
+	for (size_t k = 0; k < andbits.size(); k++) {
+		AndBIT* andbit = andbits[k];
+		unsigned long seed = _rng();
+		expansion_futures.push_back(pool.submit([this, andbit, seed, k]() {
+			RandGen rng = ure_substream(seed, k);
+			return expansion(*andbit, rng);
+		}));
+	}
+	std::vector<Expansion> expansions;
+	for (auto& ef : expansion_futures)
+		ef.wait();
+	for (auto& ef : expansion_futures)
+		expansions.push_back(ef.get());
+
+	// The selected and-BITs may have been exhausted
+	for (AndBIT* andbit : andbits)
+		_bit.update_weight(*andbit);
+
+	// Insert the expanded and-BITs, in selection order, and queue
+	// them for fulfillment if it is asynchronous. Otherwise keep
+	// their FCS for parallel fulfillment.
+	bool async = _config.get_async_fulfillment();
+	HandleSeq fcss;
+	for (Expansion& exp : expansions) {
+		const AndBIT* andbit = insert_expansion(exp);
+		if (andbit and async)
+			enqueue_fulfillment(*andbit);
+		else if (andbit)
+			fcss.push_back(andbit->fcs);
+	}
+
+	// Fulfill the inserted and-BITs in parallel. As in fulfill_bit,
+	// failures of the pattern matcher are ignored.
+	std::vector<std::future<void>> fulfillment_futures;
+	for (const Handle& fcs : fcss) {
+		LAZY_URE_LOG_DEBUG << "Selected and-BIT for fulfillment (fcs value):"
+		                   << std::endl << fcs->id_to_string();
+		fulfillment_futures.push_back(pool.submit([this, fcs]() {
+			try {
+				fulfill_fcs(fcs);
+			} catch (...) {}
+		}));
 	}
+	for (auto& ff : fulfillment_futures)
+		ff.wait();
 }
 
 void BackwardChainer::fulfill_bit()
@@ -254,6 +400,11 @@ void BackwardChainer::fulfill_bit()
 	LAZY_URE_LOG_DEBUG << "Selected and-BIT for fulfillment (fcs value):"
 	                   << std::endl << andbit->fcs->id_to_string();
 
+	if (_config.get_async_fulfillment()) {
+		enqueue_fulfillment(*andbit);
+		return;
+	}
+
 	// Wrap in a try/catch in case the pattern matcher can't handle
 	// it.
 	try {
@@ -283,42 +434,141 @@ void BackwardChainer::fulfill_fcs(const Handle& fcs)
 	// capabilities of the AtomSpace.
 	Handle hresult = HandleCast(fcs->execute(&tmp_as));
 	HandleSeq results;
-	for (const Handle& result : hresult->getOutgoingSet())
+	HandleSet new_atoms;
+	for (const Handle& result : hresult->getOutgoingSet()) {
+		get_new_atoms(result, new_atoms);
 		results.push_back(_kb_as.add_atom(result));
+	}
+	_budget.add_pm_execution();
+	_budget.add_produced_atoms(results.size());
 	LAZY_URE_LOG_DEBUG << "Results:" << std::endl << results;
-	_results.insert(results.begin(), results.end());
+	{
+		std::lock_guard<std::mutex> lock(_results_mutex);
+		_results.insert(results.begin(), results.end());
+	}
+
+	// Pass the new atoms to the next meta rule expansion
+	if (not new_atoms.empty()) {
+		std::lock_guard<std::mutex> lock(_meta_rules_mutex);
+		for (const Handle& h : new_atoms)
+			_meta_rules_delta.insert(_kb_as.get_atom(h));
+	}
 
 	// Record the results in _trace_as
 	for (const Handle& result : results)
 		_trace_recorder.proof(fcs, result);
 }
 
+void BackwardChainer::get_new_atoms(const Handle& h, HandleSet& new_atoms) const
+{
+	// The outgoing atoms of an atom of the knowledge base are in it
+	// as well
+	if (_kb_as.get_atom(h))
+		return;
+	new_atoms.insert(h);
+	if (h->is_link())
+		for (const Handle& child : h->getOutgoingSet())
+			get_new_atoms(child, new_atoms);
+}
+
+bool BackwardChainer::QueuedFCS::operator<(const QueuedFCS& other) const
+{
+	// The top of the queue is the greatest, thus the fittest, then
+	// the earliest.
+	return fitness < other.fitness
+		or (fitness == other.fitness and other.order < order);
+}
+
+void BackwardChainer::enqueue_fulfillment(const AndBIT& andbit)
+{
+	{
+		std::lock_guard<std::mutex> lock(_fulfillment_mutex);
+		_fulfillment_queue.push({_andbit_fitness(andbit),
+		                         _queued_fcs_count++, andbit.fcs});
+		_unfulfilled_fcss.insert(andbit.fcs);
+	}
+
+	// One task per queued FCS. A task fulfills the fittest FCS queued
+	// by the time it runs, not necessarily that one.
+	get_fulfillment_pool().submit([this]() { fulfill_next(); });
+}
+
+void BackwardChainer::fulfill_next()
+{
+	Handle fcs;
+	{
+		std::lock_guard<std::mutex> lock(_fulfillment_mutex);
+		fcs = _fulfillment_queue.top().fcs;
+		_fulfillment_queue.pop();
+	}
+
+	LAZY_URE_LOG_DEBUG << "Fulfill asynchronously and-BIT (fcs value):"
+	                   << std::endl << fcs->id_to_string();
+
+	// Wrap in a try/catch in case the pattern matcher can't handle
+	// it.
+	try {
+		fulfill_fcs(fcs);
+	} catch (...) {}
+
+	{
+		std::lock_guard<std::mutex> lock(_fulfillment_mutex);
+		_unfulfilled_fcss.erase(_unfulfilled_fcss.find(fcs));
+	}
+	_fulfillment_cv.notify_all();
+}
+
+void BackwardChainer::wait_fulfillments()
+{
+	std::unique_lock<std::mutex> lock(_fulfillment_mutex);
+	_fulfillment_cv.wait(lock, [&]() { return _unfulfilled_fcss.empty(); });
+}
+
 std::vector<double> BackwardChainer::expansion_andbit_weights()
 {
 	std::vector<double> weights;
-	for (const AndBIT& andbit : _bit.andbits)
-		weights.push_back(operator()(andbit));
+	for (const AndBIT* andbit : _bit.andbits)
+		weights.push_back(_bit.get_weight(*andbit));
 	return weights;
 }
 
 AndBIT* BackwardChainer::select_expansion_andbit()
 {
-	std::vector<double> weights = expansion_andbit_weights();
-
 	// Debug log
 	if (ure_logger().is_debug_enabled()) {
-		OC_ASSERT(weights.size() == _bit.andbits.size());
+		std::vector<double> weights = expansion_andbit_weights();
 		std::stringstream ss;
 		ss << "Weighted and-BITs:";
-		for (size_t i = 0; i < weights.size(); i++)
+		auto it = _bit.andbits.begin();
+		for (size_t i = 0; i < weights.size(); i++, it++)
 			ss << std::endl << weights[i] << " "
-			   << _bit.andbits[i].fcs->id_to_string();
+			   << (*it)->fcs->id_to_string();
 		ure_logger().debug() << ss.str();
 	}
 
-	// Sample andbits according to this distribution
-	std::discrete_distribution<size_t> dist(weights.begin(), weights.end());
-	return &rand_element(_bit.andbits, dist);
+	// Sample andbits according to their weights
+	return _bit.sample(_rng);
+}
+
+std::vector<AndBIT*> BackwardChainer::select_expansion_andbits(size_t n)
+{
+	return _bit.sample(n, _rng);
+}
+
+ThreadPool& BackwardChainer::get_thread_pool()
+{
+	unsigned jobs = std::max(1, _config.get_jobs());
+	if (not _thread_pool or _thread_pool->size() != jobs)
+		_thread_pool.reset(new ThreadPool(jobs));
+	return *_thread_pool;
+}
+
+ThreadPool& BackwardChainer::get_fulfillment_pool()
+{
+	unsigned jobs = std::max(1, _config.get_jobs());
+	if (not _fulfillment_pool or _fulfillment_pool->size() != jobs)
+		_fulfillment_pool.reset(new ThreadPool(jobs));
+	return *_fulfillment_pool;
 }
 
 const AndBIT* BackwardChainer::select_fulfillment_andbit() const
@@ -331,56 +581,83 @@ void BackwardChainer::reduce_bit()
 	if (0 < _config.get_max_bit_size()) {
 		// If the BIT size has reached its maximum, randomly remove
 		// and-BITs so that the BIT size gets back below or equal to
-		// its maximum.
-		while (_config.get_max_bit_size() < _bit.size()) {
-			// Randomly select an and-BIT that is unlikely to be used
-			// for the remaining of the inferenceThe and-BITs to remove are
-			// selected so that the least likely and-BITs to be
-			// selected for expansion are removed first.
-			remove_unlikely_expandable_andbit();
-		}
+		// its maximum. The and-BITs to remove are selected so that
+		// the least likely and-BITs to be selected for expansion are
+		// removed first.
+		size_t max_bit_size = _config.get_max_bit_size();
+		if (max_bit_size < _bit.size())
+			remove_unlikely_expandable_andbits(_bit.size() - max_bit_size);
 	}
 }
 
-void BackwardChainer::remove_unlikely_expandable_andbit()
+void BackwardChainer::remove_unlikely_expandable_andbits(size_t n)
 {
 	std::vector<double> weights = expansion_andbit_weights();
-	std::discrete_distribution<size_t> dist(weights.begin(), weights.end());
-	std::vector<double> never_expand_probs;
+	double total = std::accumulate(weights.begin(), weights.end(), 0.0);
 
 	// Calculate the probability of never being expanded for the
 	// remainder of the inference, thus (1-p) raised to the power of
 	// _config.get_maximum_iterations() - _iteration. This makes
 	// the assumption that the BIT (i.e. its and-BIT population) is
 	// not gonna change from this point on, a false but OK assumption
-	// for now.
-	for (double p : dist.probabilities()) {
-		double remaining_iterations =
-			_config.get_maximum_iterations() - _iteration;
-		double nep = std::pow(1 - p, remaining_iterations);
-		never_expand_probs.push_back(nep);
+	// for now. If the number of iterations is unlimited, a single
+	// remaining iteration is assumed, which preserves the ranking.
+	//
+	// These probabilities are calculated once for all the and-BITs
+	// to remove, and kept in a sum tree to sample them.
+	double remaining_iterations = 0 <= _config.get_maximum_iterations() ?
+		_config.get_maximum_iterations() - _iteration : 1;
+	SumTree never_expand_probs;
+	for (double w : weights) {
+		double p = 0.0 < total ? w / total : 1.0 / weights.size();
+		never_expand_probs.push_back(std::pow(1 - p, remaining_iterations));
 	}
 
 	// Fine log
 	if (ure_logger().is_fine_enabled()) {
-		OC_ASSERT(never_expand_probs.size() == _bit.andbits.size());
 		std::stringstream ss;
 		ss << "Never expand probs and-BITs:";
-		for (size_t i = 0; i < never_expand_probs.size(); i++)
-			ss << std::endl << never_expand_probs[i] << " "
-			   << _bit.andbits[i].fcs->id_to_string();
+		auto it = _bit.andbits.begin();
+		for (size_t i = 0; i < never_expand_probs.size(); i++, it++)
+			ss << std::endl << never_expand_probs.get(i) << " "
+			   << (*it)->fcs->id_to_string();
 		ure_logger().fine() << ss.str();
 	}
 
-	std::discrete_distribution<size_t>
-		never_expand_dist(never_expand_probs.begin(), never_expand_probs.end());
+	// Pick the and-BITs, without replacement. The ones whose FCS is
+	// queued or being fulfilled are excluded, as removing their FCS
+	// would pull it from under the worker fulfilling it.
+	std::vector<AndBIT*> positions(_bit.andbits.begin(), _bit.andbits.end()),
+		removed;
+	std::vector<bool> picked(positions.size(), false);
+	{
+		std::lock_guard<std::mutex> lock(_fulfillment_mutex);
+		for (size_t i = 0; i < positions.size(); i++) {
+			if (_unfulfilled_fcss.count(positions[i]->fcs)) {
+				picked[i] = true;
+				never_expand_probs.set(i, 0.0);
+			}
+		}
+	}
+	n = std::min(n, (size_t)std::count(picked.begin(), picked.end(), false));
+	while (removed.size() < n) {
+		// If the remaining and-BITs are all certain to be expanded,
+		// pick uniformly amongst them
+		if (never_expand_probs.total() <= 0.0)
+			for (size_t i = 0; i < positions.size(); i++)
+				if (not picked[i])
+					never_expand_probs.set(i, 1.0);
+
+		size_t i = never_expand_probs(_rng);
+		LAZY_URE_LOG_DEBUG << "Remove " << positions[i]->fcs->id_to_string()
+		                   << " from the BIT";
+		removed.push_back(positions[i]);
+		picked[i] = true;
+		never_expand_probs.set(i, 0.0);
+	}
 
-	// Pick the and-BIT, remove it from the BIT and remove its
-	// FCS from the bit atomspace.
-	auto it = std::next(_bit.andbits.begin(), never_expand_dist(randGen()));
-	LAZY_URE_LOG_DEBUG << "Remove " << it->fcs->id_to_string()
-	                   << " from the BIT";
-	_bit.erase(it);
+	// Remove them from the BIT and their FCS from the bit atomspace
+	_bit.erase(removed);
 }
 
 double BackwardChainer::complexity_factor(const AndBIT& andbit) const
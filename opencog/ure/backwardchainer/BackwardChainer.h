@@ -25,8 +25,16 @@
 #ifndef _OPENCOG_BACKWARDCHAINER_H_
 #define _OPENCOG_BACKWARDCHAINER_H_
 
+#include <condition_variable>
+#include <mutex>
+#include <queue>
+#include <unordered_set>
+
 #include "../Rule.h"
 #include "../UREConfig.h"
+#include "../Budget.h"
+#include "../URERandom.h"
+#include "../ThreadPool.h"
 #include "BIT.h"
 #include "TraceRecorder.h"
 #include "ControlPolicy.h"
@@ -152,6 +160,14 @@ public:
 
 	/**
 	 * Perform a single backward chaining inference step.
+	 *
+	 * If the number of jobs is greater than 1, up to that many
+	 * distinct and-BITs are expanded, then fulfilled, in parallel
+	 * during that step.
+	 *
+	 * If asynchronous fulfillment is enabled, the expanded and-BITs
+	 * are only queued for fulfillment, which may thus still be
+	 * pending after that step. do_chain waits for all of them.
 	 */
 	void do_step();
 
@@ -172,6 +188,17 @@ public:
 	const HandleSet& get_results_set() const;
 
 private:
+	// Expansion of an and-BIT, computed but not yet inserted in the
+	// BIT. The FCS of the expanded and-BIT is undefined if the
+	// expansion has failed.
+	struct Expansion
+	{
+		const AndBIT* andbit = nullptr;
+		const BITNode* bitleaf = nullptr;
+		Rule rule;
+		AndBIT expanded;
+	};
+
 	void expand_meta_rules();
 
 	// Expand the BIT
@@ -181,6 +208,20 @@ private:
 	// will keep a record of the expansion if successful.
 	void expand_bit(AndBIT& andbit);
 
+	// Select a leaf of andbit and a rule, drawn from rng, and return
+	// the resulting expansion without modifying the BIT, so that it
+	// can be called concurrently over distinct and-BITs.
+	Expansion expansion(AndBIT& andbit, RandGen& rng);
+
+	// Insert the expanded and-BIT in the BIT and record the expansion
+	// in the trace atomspace. Return the inserted and-BIT, nullptr if
+	// the expansion has failed or its and-BIT is already in the BIT.
+	const AndBIT* insert_expansion(Expansion& expansion);
+
+	// Expand up to jobs distinct and-BITs in parallel, insert the
+	// expanded and-BITs in the BIT, then fulfill them in parallel.
+	void expand_fulfill_bit_parallel();
+
 	// Fulfill the BIT. That is run some or all its and-BITs
 	void fulfill_bit();
 
@@ -188,20 +229,51 @@ private:
 	// strategy.
 	void fulfill_fcs(const Handle& fcs);
 
-	// Reduce the BIT. Remove some and-BITs.
+	// Insert in new_atoms h and its outgoing atoms, recursively, that
+	// are not in the knowledge base.
+	void get_new_atoms(const Handle& h, HandleSet& new_atoms) const;
+
+	// Queue the FCS of an and-BIT for asynchronous fulfillment by the
+	// fulfillment pool. The fittest and-BITs are fulfilled first.
+	void enqueue_fulfillment(const AndBIT& andbit);
+
+	// Pop the fittest queued FCS and fulfill it. Run by the workers.
+	void fulfill_next();
+
+	// Wait till all queued FCS have been fulfilled.
+	void wait_fulfillments();
+
+	// Reduce the BIT. Remove some and-BITs, except the ones whose FCS
+	// is queued or being fulfilled.
 	void reduce_bit();
 
-	// Pick up an and-BIT randomly, biased so that this and-BIT is
-	// unlikely to be expanded for the remainder of the inference.
-	void remove_unlikely_expandable_andbit();
+	// Pick up n and-BITs randomly, without replacement, biased so
+	// that these and-BITs are unlikely to be expanded for the
+	// remainder of the inference, and remove them all at once.
+	void remove_unlikely_expandable_andbits(size_t n);
 
 	// Calculate distribution based on a (poor) estimate of the
-	// probablity of a and-BIT being within the path of the solution.
+	// probablity of a and-BIT being within the path of the solution,
+	// see operator(). The weights are cached in the BIT, in the order
+	// of _bit.andbits.
 	std::vector<double> expansion_andbit_weights();
 
 	// Select an and-BIT for expansion
 	AndBIT* select_expansion_andbit();
 
+	// Select up to n distinct and-BITs for expansion, sampled without
+	// replacement according to their expansion weights.
+	std::vector<AndBIT*> select_expansion_andbits(size_t n);
+
+	// Return the thread pool, (re)creating it if its number of
+	// workers does not match the number of jobs.
+	ThreadPool& get_thread_pool();
+
+	// Return the pool running asynchronous fulfillments, distinct
+	// from the one running expansions so that expanding never waits
+	// for pending fulfillments. (Re)created like get_thread_pool.
+	ThreadPool& get_fulfillment_pool();
+
 	// Select an and-BIT for fulfilment. Return nullptr if none have
 	// been selected.
 	const AndBIT* select_fulfillment_andbit() const;
@@ -225,6 +297,9 @@ private:
 	// Contain the configuration
 	UREConfig _config;
 
+	// Resource budget, see UREConfig
+	Budget _budget;
+
 	// Structure holding the Back Inference Tree
 	BIT _bit;
 
@@ -242,11 +317,59 @@ private:
 
 	int _iteration;
 
+	// Seed of the random draws of the current chaining, and
+	// generator of the substream of the current iteration, see
+	// ure_substream.
+	unsigned long _seed;
+	RandGen _rng;
+
 	// Keep track of the and-BIT of the last expansion. Null if the
 	// last expansion has failed.
 	const AndBIT* _last_expansion_andbit;
 
 	HandleSet _results;
+
+	// Guard _results during parallel fulfillment
+	std::mutex _results_mutex;
+
+	// FCS queued for asynchronous fulfillment, ordered by fitness of
+	// their and-BITs, then by order of arrival.
+	struct QueuedFCS
+	{
+		double fitness;
+		size_t order;
+		Handle fcs;
+
+		bool operator<(const QueuedFCS& other) const;
+	};
+	std::priority_queue<QueuedFCS> _fulfillment_queue;
+
+	// Number of FCS ever queued, to order them by arrival
+	size_t _queued_fcs_count;
+
+	// FCS queued or being fulfilled, kept out of BIT reduction
+	std::unordered_multiset<Handle> _unfulfilled_fcss;
+
+	// Guard the fulfillment queue and counts, and signal when all
+	// queued FCS have been fulfilled.
+	std::mutex _fulfillment_mutex;
+	std::condition_variable _fulfillment_cv;
+
+	// Whether meta rules have been expanded over the whole knowledge
+	// base, and the atoms added by fulfillment since the last
+	// expansion, that subsequent expansions only go over. The latter
+	// is guarded by _meta_rules_mutex.
+	bool _meta_rules_expanded;
+	HandleSet _meta_rules_delta;
+	std::mutex _meta_rules_mutex;
+
+	// Thread pools for parallel expansion and synchronous
+	// fulfillment, only created if the number of jobs is greater
+	// than 1, and for asynchronous fulfillment, only created if it is
+	// enabled. They are declared last so that their pending tasks
+	// are processed before any other member is destroyed.
+	std::unique_ptr<ThreadPool> _thread_pool;
+	std::unique_ptr<ThreadPool> _fulfillment_pool;
 };
 
 
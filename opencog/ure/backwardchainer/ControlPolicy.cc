@@ -75,7 +75,8 @@ ControlPolicy::~ControlPolicy()
 	delete(_query_as);
 }
 
-RuleSelection ControlPolicy::select_rule(AndBIT& andbit, BITNode& bitleaf)
+RuleSelection ControlPolicy::select_rule(AndBIT& andbit, BITNode& bitleaf,
+                                         RandGen& rng)
 {
 	// The rule is randomly selected amongst the valid ones, with
 	// probability of selection being proportional to its weight.
@@ -93,7 +94,7 @@ RuleSelection ControlPolicy::select_rule(AndBIT& andbit, BITNode& bitleaf)
 		LAZY_URE_LOG_DEBUG << ss.str();
 	}
 
-	return select_rule(andbit, bitleaf, valid_rules);
+	return select_rule(andbit, bitleaf, valid_rules, rng);
 }
 
 HandleSet ControlPolicy::rule_aliases(const RuleTypedSubstitutionMap& rules)
@@ -139,7 +140,8 @@ RuleTypedSubstitutionMap ControlPolicy::get_valid_rules(const AndBIT& andbit,
 
 RuleSelection ControlPolicy::select_rule(const AndBIT& andbit,
                                          const BITNode& bitleaf,
-                                         const RuleTypedSubstitutionMap& inf_rules)
+                                         const RuleTypedSubstitutionMap& inf_rules,
+                                         RandGen& rng)
 {
 	// Build a mapping from rule to TV of expansion success
 	HandleTVMap success_tvs = expansion_success_tvs(andbit, bitleaf, inf_rules);
@@ -147,7 +149,8 @@ RuleSelection ControlPolicy::select_rule(const AndBIT& andbit,
 
 	// Sample an inference rule according to the distribution
 	std::discrete_distribution<size_t> dist(weights.begin(), weights.end());
-	const RuleTypedSubstitutionPair& selected_rule = rand_element(inf_rules, dist);
+	const RuleTypedSubstitutionPair& selected_rule =
+		*std::next(inf_rules.begin(), dist(rng));
 
 	// Return the selected rule and its probability of success, will
 	// be used to calculate the TV that the produce and-BIT is a
@@ -244,9 +247,15 @@ HandleSet ControlPolicy::active_expansion_control_rules(
 	if (!_control_as)
 		return HandleSet();
 
+	// Look the control rules up without inserting, as this may be
+	// called concurrently by the backward chainer.
+	auto it = _expansion_control_rules.find(inf_rule_alias);
+	if (it == _expansion_control_rules.end())
+		return HandleSet();
+
 	// Filter out inactive expansion control rules
 	HandleSet results;
-	for (const Handle& ctrl_rule : _expansion_control_rules[inf_rule_alias])
+	for (const Handle& ctrl_rule : it->second)
 		if (is_control_rule_active(andbit, bitleaf, ctrl_rule))
 			results.insert(ctrl_rule);
 
@@ -73,7 +73,8 @@ public:
 	 * The andbit and bitleaf are not const because if the rules are
 	 * exhausted it will set its exhausted flag to false.
 	 */
-	RuleSelection select_rule(AndBIT& andbit, BITNode& bitleaf);
+	RuleSelection select_rule(AndBIT& andbit, BITNode& bitleaf,
+	                          RandGen& rng=randGen());
 
 	/**
 	 * Return the set of rule aliases (i,e. DefineSchema pointing to
@@ -127,7 +128,8 @@ private:
 	 */
 	RuleSelection select_rule(const AndBIT& andbit,
 	                          const BITNode& bitleaf,
-	                          const RuleTypedSubstitutionMap& rules);
+	                          const RuleTypedSubstitutionMap& rules,
+	                          RandGen& rng);
 
 	/**
 	 * Return the conditional TVs that a given rule expands a supposed
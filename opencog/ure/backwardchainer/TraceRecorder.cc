@@ -41,11 +41,19 @@ TraceRecorder::TraceRecorder(AtomSpace* tr_as) : _trace_as(tr_as) {
 			_trace_as->add_node(SCHEMA_NODE, std::move(std::string(expand_andbit_schema_name)));
 		_proof_predicate =
 			_trace_as->add_node(PREDICATE_NODE, std::move(std::string(proof_predicate_name)));
+		_trace_writer.reset(new TraceWriter(*_trace_as));
 	}
 }
 
+void TraceRecorder::flush()
+{
+	if (_trace_writer)
+		_trace_writer->flush();
+}
+
 HandleSeqSet TraceRecorder::traces()
 {
+	flush();
 	HandleSeqSet trs;
 	for (const Handle& fcs_proof : get_fcs_proofs())
 		set_union_modify(trs, traces(fcs_proof));
@@ -54,6 +62,7 @@ HandleSeqSet TraceRecorder::traces()
 
 HandleSeqSet TraceRecorder::traces(const Handle& fcs)
 {
+	flush();
 	HandleSet expansion_sources(get_expansion_sources(fcs));
 
 	// Unwrap DontExecLink around the fcs
@@ -81,82 +90,75 @@ void TraceRecorder::target(const Handle& target)
 
 void TraceRecorder::andbit(const AndBIT& andbit)
 {
-	add_evaluation(_andbit_predicate,
-	               dont_exec(andbit.fcs),
-	               TruthValue::TRUE_TV());
+	add_evaluation(_andbit_predicate, andbit.fcs, TruthValue::TRUE_TV(), true);
 }
 
 void TraceRecorder::expansion(const Handle& andbit_fcs, const Handle& bitleaf_body,
                               const Rule& rule, const AndBIT& new_andbit)
 {
 	add_execution(_expand_andbit_schema,
-	              dont_exec(andbit_fcs), bitleaf_body,
-	              dont_exec(rule.get_alias()),
-	              dont_exec(new_andbit.fcs), TruthValue::TRUE_TV());
+	              andbit_fcs, bitleaf_body, rule.get_alias(),
+	              new_andbit.fcs, TruthValue::TRUE_TV(),
+	              {true, false, true}, true);
 }
 
 void TraceRecorder::proof(const Handle& andbit_fcs, const Handle& target_result)
 {
 	add_evaluation(_proof_predicate,
-	               dont_exec(andbit_fcs), target_result,
-	               target_result->getTruthValue());
+	               andbit_fcs, target_result,
+	               target_result->getTruthValue(), {true, false});
 }
 
-Handle TraceRecorder::dont_exec(const Handle& h)
+void TraceRecorder::add_execution(const Handle& schema,
+                                  const Handle& input, const Handle& output,
+                                  TruthValuePtr tv)
 {
-	if (not _trace_as)
-		return Handle::UNDEFINED;
+	if (not _trace_writer)
+		return;
 
-	return _trace_as->add_link(DONT_EXEC_LINK, h);
+	_trace_writer->write_executions(schema, {input}, {output}, tv);
 }
 
-Handle TraceRecorder::add_execution(const Handle& schema,
-                                    const Handle& input, const Handle& output,
-                                    TruthValuePtr tv)
+void TraceRecorder::add_execution(const Handle& schema,
+                                  const Handle& input1,
+                                  const Handle& input2,
+                                  const Handle& input3,
+                                  const Handle& output,
+                                  TruthValuePtr tv,
+                                  std::vector<bool> dont_exec_inputs,
+                                  bool dont_exec_output)
 {
-	if (not _trace_as)
-		return Handle::UNDEFINED;
+	if (not _trace_writer)
+		return;
 
-	Handle execution = _trace_as->add_link(EXECUTION_LINK, schema, input, output);
-	execution->setTruthValue(tv);
-	return execution;
+	_trace_writer->write_executions(schema, {input1, input2, input3},
+	                                {output}, tv, -1,
+	                                std::move(dont_exec_inputs),
+	                                dont_exec_output);
 }
 
-Handle TraceRecorder::add_execution(const Handle& schema,
-                                    const Handle& input1,
-                                    const Handle& input2,
-                                    const Handle& input3,
-                                    const Handle& output,
-                                    TruthValuePtr tv)
+void TraceRecorder::add_evaluation(const Handle& predicate,
+                                   const Handle& argument,
+                                   TruthValuePtr tv,
+                                   bool dont_exec_argument)
 {
-	if (not _trace_as)
-		return Handle::UNDEFINED;
+	if (not _trace_writer)
+		return;
 
-	Handle inputs = _trace_as->add_link(LIST_LINK, input1, input2, input3);
-	return add_execution(schema, inputs, output, tv);
-}
-
-Handle TraceRecorder::add_evaluation(const Handle& predicate,
-                                     const Handle& argument,
-                                     TruthValuePtr tv)
-{
-	if (not _trace_as)
-		return Handle::UNDEFINED;
-	
-	Handle evaluation = _trace_as->add_link(EVALUATION_LINK, predicate, argument);
-	evaluation->setTruthValue(tv);
-	return evaluation;
+	_trace_writer->write_evaluation(predicate, {argument}, tv,
+	                                {dont_exec_argument});
 }
 
-Handle TraceRecorder::add_evaluation(const Handle& predicate,
-                                     const Handle& arg1, const Handle& arg2,
-                                     TruthValuePtr tv)
+void TraceRecorder::add_evaluation(const Handle& predicate,
+                                   const Handle& arg1, const Handle& arg2,
+                                   TruthValuePtr tv,
+                                   std::vector<bool> dont_exec_arguments)
 {
-	if (not _trace_as)
-		return Handle::UNDEFINED;
+	if (not _trace_writer)
+		return;
 
-	Handle arguments = _trace_as->add_link(LIST_LINK, arg1, arg2);
-	return add_evaluation(predicate, arguments, tv);
+	_trace_writer->write_evaluation(predicate, {arg1, arg2}, tv,
+	                                std::move(dont_exec_arguments));
 }
 
 HandleSet TraceRecorder::get_expansion_sources(const Handle& fcs_target)
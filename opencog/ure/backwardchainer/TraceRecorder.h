@@ -23,10 +23,13 @@
 #ifndef _OPENCOG_TRACERECORDER_H_
 #define _OPENCOG_TRACERECORDER_H_
 
+#include <memory>
+
 #include <opencog/atomspace/AtomSpace.h>
 
 #include "BIT.h"
 #include "../Rule.h"
+#include "../TraceWriter.h"
 
 namespace opencog
 {
@@ -41,6 +44,11 @@ public:
 
 	TraceRecorder(AtomSpace* tr_as);
 
+	// Wait till all recorded traces have been written into the trace
+	// atomspace. Recording methods below only submit them to a
+	// background writer.
+	void flush();
+
 	// Return the traces of fcs leading to the recorded proofs
 	HandleSeqSet traces();
 
@@ -99,14 +107,16 @@ public:
 private:
 	AtomSpace* _trace_as;
 
+	// Write traces into _trace_as in the background. Null if there is
+	// no trace atomspace.
+	std::unique_ptr<TraceWriter> _trace_writer;
+
 	Handle _target_predicate, _andbit_predicate, _expand_andbit_schema,
 		_proof_predicate;
 
-	// Wrap a DontExecLink around h
-	//
-	// DontExecLink
-	//   h
-	Handle dont_exec(const Handle& h);
+	// The following submit traces to _trace_writer, which builds
+	// their links, including the DontExecLinks wrapping the inputs,
+	// outputs or arguments flagged by dont_exec_*.
 
 	// Add
 	//
@@ -114,9 +124,9 @@ private:
 	//   <schema>
 	//   <input>
 	//   <output>
-	Handle add_execution(const Handle& schema,
-	                     const Handle& input, const Handle& output,
-	                     TruthValuePtr tv);
+	void add_execution(const Handle& schema,
+	                   const Handle& input, const Handle& output,
+	                   TruthValuePtr tv);
 
 	// Add
 	//
@@ -127,21 +137,24 @@ private:
 	//     <input2>
 	//     <input3>
 	//   <output>
-	Handle add_execution(const Handle& schema,
-	                     const Handle& input1,
-	                     const Handle& input2,
-	                     const Handle& input3,
-	                     const Handle& output,
-	                     TruthValuePtr tv);
+	void add_execution(const Handle& schema,
+	                   const Handle& input1,
+	                   const Handle& input2,
+	                   const Handle& input3,
+	                   const Handle& output,
+	                   TruthValuePtr tv,
+	                   std::vector<bool> dont_exec_inputs={},
+	                   bool dont_exec_output=false);
 
 	// Add
 	//
 	// Evaluation <tv>
 	//   <predicate>
 	//   <argument>
-	Handle add_evaluation(const Handle& predicate,
-	                      const Handle& argument,
-	                      TruthValuePtr tv);
+	void add_evaluation(const Handle& predicate,
+	                    const Handle& argument,
+	                    TruthValuePtr tv,
+	                    bool dont_exec_argument=false);
 
 	// Add
 	//
@@ -150,9 +163,10 @@ private:
 	//   List
 	//     <arg1>
 	//     <arg2>
-	Handle add_evaluation(const Handle& predicate,
-	                      const Handle& arg1, const Handle& arg2,
-	                      TruthValuePtr tv);
+	void add_evaluation(const Handle& predicate,
+	                    const Handle& arg1, const Handle& arg2,
+	                    TruthValuePtr tv,
+	                    std::vector<bool> dont_exec_arguments={});
 
 	// Given a fcs, return all fcs that expands to this fcs target.
 	HandleSet get_expansion_sources(const Handle& fcs_target);
@@ -0,0 +1,169 @@
+/*
+ * AlphaNetwork.cc
+ *
+ * Copyright (C) 2020 SingularityNET Foundation
+ *
+ * Authors: Nil Geisweiller
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License v3 as
+ * published by the Free Software Foundation and including the exceptions
+ * at http://opencog.org/wiki/Licenses
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program; if not, write to:
+ * Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "AlphaNetwork.h"
+
+#include <sstream>
+
+#include <boost/range/algorithm_ext/erase.hpp>
+
+#include <opencog/util/algorithm.h>
+#include <opencog/atoms/base/Link.h>
+
+#include "../URELogger.h"
+
+namespace opencog {
+
+const int AlphaNetwork::any_arity = -1;
+
+AlphaNetwork::AlphaNetwork()
+	: _generation(0)
+{
+}
+
+bool AlphaNetwork::compile(const RuleSet& rules, unsigned generation)
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+	if (not _rules.empty() and generation == _generation)
+		return false;
+
+	_rules.clear();
+	_rule_index.clear();
+	_wildcard_rules.clear();
+	_candidates.clear();
+	_generation = generation;
+
+	for (const RulePtr& rule : rules) {
+		// Meta rules are expanded by the forward chainer, not
+		// activated.
+		if (rule->is_meta())
+			continue;
+
+		size_t ri = _rules.size();
+		_rules.push_back(rule);
+		for (const Handle& premise : rule->get_premises()) {
+			// Variables and quotations may match atoms of any type
+			Type t = premise->get_type();
+			if (t == VARIABLE_NODE or t == GLOB_NODE or
+			    t == QUOTE_LINK or t == LOCAL_QUOTE_LINK)
+				_wildcard_rules.insert(ri);
+			else
+				_rule_index[mk_premise_key(premise)].insert(ri);
+		}
+	}
+
+	ure_logger().debug() << "Compiled " << _rules.size() << " rules into "
+	                     << _rule_index.size() << " premise keys";
+	return true;
+}
+
+unsigned AlphaNetwork::get_generation() const
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+	return _generation;
+}
+
+void AlphaNetwork::push(const SourcePtr& source)
+{
+	// Find the rules having a premise discriminating the source
+	std::lock_guard<std::mutex> lock(_mutex);
+	std::set<size_t> rule_indices(_wildcard_rules);
+	AlphaKey key = mk_key(source->body);
+	for (const AlphaKey& k : {key, AlphaKey(key.first, any_arity)}) {
+		auto it = _rule_index.find(k);
+		if (it != _rule_index.end())
+			rule_indices.insert(it->second.begin(), it->second.end());
+	}
+
+	for (size_t ri : rule_indices)
+		_candidates.emplace_back(source, _rules[ri]);
+}
+
+void AlphaNetwork::push_front(const SourceRule& candidate)
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+	_candidates.push_front(candidate);
+}
+
+void AlphaNetwork::erase_sources(const std::vector<size_t>& source_ids)
+{
+	std::set<size_t> ids(source_ids.begin(), source_ids.end());
+	std::lock_guard<std::mutex> lock(_mutex);
+	boost::remove_erase_if(_candidates, [&](const SourceRule& sr) {
+			return is_in(sr.source->id, ids); });
+}
+
+SourceRule AlphaNetwork::pop()
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+	if (_candidates.empty())
+		return SourceRule();
+	SourceRule sr = _candidates.front();
+	_candidates.pop_front();
+	return sr;
+}
+
+bool AlphaNetwork::empty() const
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+	return _candidates.empty();
+}
+
+size_t AlphaNetwork::size() const
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+	return _candidates.size();
+}
+
+std::string AlphaNetwork::to_string(const std::string& indent) const
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+	std::stringstream ss;
+	ss << indent << "rules = " << _rules.size() << std::endl
+	   << indent << "premise keys = " << _rule_index.size() << std::endl
+	   << indent << "wildcard rules = " << _wildcard_rules.size();
+	ss << std::endl << indent << "pending candidates = " << _candidates.size();
+	return ss.str();
+}
+
+AlphaNetwork::AlphaKey AlphaNetwork::mk_key(const Handle& h)
+{
+	return {h->get_type(), h->is_link() ? (int)h->get_arity() : 0};
+}
+
+AlphaNetwork::AlphaKey AlphaNetwork::mk_premise_key(const Handle& premise)
+{
+	AlphaKey key = mk_key(premise);
+	if (premise->is_link())
+		for (const Handle& child : premise->getOutgoingSet())
+			if (child->get_type() == GLOB_NODE)
+				key.second = any_arity;
+	return key;
+}
+
+std::string oc_to_string(const AlphaNetwork& an, const std::string& indent)
+{
+	return an.to_string(indent);
+}
+
+} // ~namespace opencog
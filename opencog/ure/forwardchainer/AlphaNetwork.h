@@ -0,0 +1,143 @@
+/*
+ * AlphaNetwork.h
+ *
+ * Copyright (C) 2020 SingularityNET Foundation
+ *
+ * Authors: Nil Geisweiller
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License v3 as
+ * published by the Free Software Foundation and including the exceptions
+ * at http://opencog.org/wiki/Licenses
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program; if not, write to:
+ * Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+#ifndef _OPENCOG_ALPHANETWORK_H_
+#define _OPENCOG_ALPHANETWORK_H_
+
+#include <deque>
+#include <map>
+#include <mutex>
+#include <set>
+#include <vector>
+
+#include <opencog/util/empty_string.h>
+
+#include "SourceRuleSet.h"
+
+namespace opencog
+{
+
+/**
+ * Per-rule discrimination index, incrementally producing candidate
+ * (source, rule) pairs as sources are pushed through it.
+ *
+ * The rules are indexed by the discrimination keys of their premises,
+ * the type and arity of the premise, so that a pushed source only
+ * becomes a candidate for the rules having a premise of the same type
+ * and arity (or a premise that is a variable). The index holds no
+ * per-source state, a source is pushed once when it is created, or
+ * again when the rules are recompiled.
+ *
+ * This is not a Rete network, there are no alpha memories, joins nor
+ * beta memories, a candidate only means that one premise of the base
+ * rule may unify with the source. The candidate is resolved into its
+ * rule specializations by the forward chainer, through the
+ * unification cache of the source (see
+ * ForwardChainer::pop_activation), and the join between premises is
+ * left to the pattern matcher when the resulting pair is applied.
+ */
+class AlphaNetwork
+{
+public:
+	AlphaNetwork();
+
+	/**
+	 * Index the non-meta rules of the given rule set, tagged by a
+	 * generation. Pending candidates are reset, as all sources are
+	 * meant to be pushed again. Return false, and do nothing, if the
+	 * network is already compiled for that generation.
+	 */
+	bool compile(const RuleSet& rules, unsigned generation);
+
+	/**
+	 * Return the rule set generation the network is compiled for.
+	 */
+	unsigned get_generation() const;
+
+	/**
+	 * Push a source through the index, queuing a candidate pair for
+	 * each base rule having a premise discriminating it.
+	 */
+	void push(const SourcePtr& source);
+
+	/**
+	 * Queue back a popped candidate, to be popped first, for
+	 * instance if some of its specializations remain to be tried.
+	 */
+	void push_front(const SourceRule& candidate);
+
+	/**
+	 * Remove the pending candidates of the sources of the given ids,
+	 * meant to be called upon eviction of these sources from the
+	 * source set.
+	 */
+	void erase_sources(const std::vector<size_t>& source_ids);
+
+	/**
+	 * Pop the oldest pending candidate, made of a source and a base
+	 * rule. Return an invalid source rule pair if there is none.
+	 */
+	SourceRule pop();
+
+	/**
+	 * Return true iff there is no pending candidate.
+	 */
+	bool empty() const;
+
+	/**
+	 * Number of pending candidates.
+	 */
+	size_t size() const;
+
+	std::string to_string(const std::string& indent=empty_string) const;
+
+private:
+	// Discrimination key of an atom, its type and arity. For premises,
+	// any_arity means that the arity is unknown due to globs.
+	typedef std::pair<Type, int> AlphaKey;
+	static const int any_arity;
+
+	static AlphaKey mk_key(const Handle& h);
+	static AlphaKey mk_premise_key(const Handle& premise);
+
+	// Compiled rules
+	std::vector<RulePtr> _rules;
+	unsigned _generation;
+
+	// Indices of the rules in _rules by premise key, and indices of
+	// the rules with a variable premise, candidates for every source.
+	std::map<AlphaKey, std::set<size_t>> _rule_index;
+	std::set<size_t> _wildcard_rules;
+
+	// Pending candidates
+	std::deque<SourceRule> _candidates;
+
+	// Guard all the above
+	mutable std::mutex _mutex;
+};
+
+std::string oc_to_string(const AlphaNetwork& an,
+                         const std::string& indent=empty_string);
+
+} // ~namespace opencog
+
+#endif /* _OPENCOG_ALPHANETWORK_H_ */
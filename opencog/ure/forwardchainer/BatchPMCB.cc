@@ -0,0 +1,126 @@
+/*
+ * BatchPMCB.cc
+ *
+ * Copyright (C) 2020 SingularityNET Foundation
+ *
+ * Authors: Nil Geisweiller
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License v3 as
+ * published by the Free Software Foundation and including the exceptions
+ * at http://opencog.org/wiki/Licenses
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program; if not, write to:
+ * Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "BatchPMCB.h"
+
+#include <opencog/query/PatternMatchEngine.h>
+
+namespace opencog {
+
+BatchPMCB::BatchPMCB(AtomSpace* kb_as,
+                     const Handle& clause,
+                     const HandleSet& bodies,
+                     const FocusSet* focus_set)
+	: Implicator(kb_as),
+	  InitiateSearchCB(kb_as),
+	  DefaultPatternMatchCB(kb_as),
+	  DefaultImplicator(kb_as),
+	  _premise(clause),
+	  _bodies(bodies),
+	  _focus_set(focus_set),
+	  _clause_match_count(0)
+{
+}
+
+void BatchPMCB::set_pattern(const Variables& vars, const Pattern& pat)
+{
+	DefaultImplicator::set_pattern(vars, pat);
+
+	// Find the clause of the pattern corresponding to the premise,
+	// once, so that callbacks only compare handles.
+	_clause = Handle::UNDEFINED;
+	for (const Handle& clause : pat.mandatory) {
+		if (content_eq(clause, _premise)) {
+			_clause = clause;
+			break;
+		}
+	}
+}
+
+bool BatchPMCB::perform_search(PatternMatchCallback& pmc)
+{
+	// Fall back to the default search if the premise is not a clause
+	// of the pattern, for instance if it has been rewritten.
+	if (not _clause)
+		return DefaultImplicator::perform_search(pmc);
+
+	// Ground the clause to each body in turn, the rest of the pattern
+	// being explored from there.
+	PatternMatchEngine pme(pmc);
+	pme.set_pattern(*_variables, *_pattern);
+	for (const Handle& body : _bodies)
+		if (pme.explore_neighborhood(_clause, _clause, body))
+			return true;
+	return false;
+}
+
+bool BatchPMCB::clause_match(const Handle& ptrn,
+                             const Handle& grnd,
+                             const GroundingMap& term_gnds)
+{
+	_clause_match_count++;
+	if (_focus_set and not _focus_set->contains(grnd))
+		return false;
+	if (is_clause(ptrn) and _bodies.find(grnd) == _bodies.end())
+		return false;
+	return DefaultImplicator::clause_match(ptrn, grnd, term_gnds);
+}
+
+bool BatchPMCB::grounding(const GroundingMap& var_soln,
+                          const GroundingMap& term_soln)
+{
+	// Remember the body of that grounding, so that the products
+	// inserted by the implicator are assigned to it
+	_body = Handle::UNDEFINED;
+	for (const auto& term_gnd : term_soln) {
+		if (is_clause(term_gnd.first)) {
+			_body = term_gnd.second;
+			break;
+		}
+	}
+	return DefaultImplicator::grounding(var_soln, term_soln);
+}
+
+void BatchPMCB::insert_result(ValuePtr v)
+{
+	if (_body)
+		_products[_body].push_back(HandleCast(v));
+	DefaultImplicator::insert_result(v);
+}
+
+const std::map<Handle, HandleSeq>& BatchPMCB::get_products() const
+{
+	return _products;
+}
+
+bool BatchPMCB::is_clause(const Handle& ptrn) const
+{
+	return _clause ? ptrn == _clause : content_eq(ptrn, _premise);
+}
+
+size_t BatchPMCB::get_clause_match_count() const
+{
+	return _clause_match_count;
+}
+
+} // ~namespace opencog
@@ -0,0 +1,107 @@
+/*
+ * BatchPMCB.h
+ *
+ * Copyright (C) 2020 SingularityNET Foundation
+ *
+ * Authors: Nil Geisweiller
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License v3 as
+ * published by the Free Software Foundation and including the exceptions
+ * at http://opencog.org/wiki/Licenses
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program; if not, write to:
+ * Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+#ifndef _OPENCOG_BATCHPMCB_H_
+#define _OPENCOG_BATCHPMCB_H_
+
+#include <map>
+
+#include <opencog/atomspace/AtomSpace.h>
+#include <opencog/query/DefaultImplicator.h>
+
+#include "FocusSet.h"
+
+namespace opencog
+{
+
+/**
+ * Pattern matcher callback applying a rule to a batch of sources at
+ * once. The search starts from the given clause of the rule, the one
+ * the sources are bound to, grounded to each body of the sources in
+ * turn, so that the cost of the query is proportional to the batch
+ * rather than to the knowledge base. The products are collected per
+ * body, so that they can be dispatched back to the source rule pairs
+ * of the batch.
+ *
+ * If a focus set is provided, any clause whose grounding is outside
+ * of it is rejected as well, like FocusSetPMCB.
+ */
+class BatchPMCB : public virtual DefaultImplicator
+{
+public:
+	BatchPMCB(AtomSpace* kb_as,
+	          const Handle& clause,
+	          const HandleSet& bodies,
+	          const FocusSet* focus_set=nullptr);
+
+	virtual void set_pattern(const Variables& vars,
+	                         const Pattern& pat);
+
+	virtual bool perform_search(PatternMatchCallback& pmc);
+
+	virtual bool clause_match(const Handle& ptrn,
+	                          const Handle& grnd,
+	                          const GroundingMap& term_gnds);
+
+	virtual bool grounding(const GroundingMap& var_soln,
+	                       const GroundingMap& term_soln);
+
+	virtual void insert_result(ValuePtr v);
+
+	/**
+	 * Return the products of the rule, indexed by the body grounding
+	 * the clause.
+	 */
+	const std::map<Handle, HandleSeq>& get_products() const;
+
+	/**
+	 * Return the number of clause groundings considered so far,
+	 * useful to check that the search stays local to the batch.
+	 */
+	size_t get_clause_match_count() const;
+
+private:
+	/**
+	 * Return true iff ptrn is the clause bound to the sources.
+	 */
+	bool is_clause(const Handle& ptrn) const;
+
+	// Clause bound to the sources, as given then as found in the
+	// pattern, so that it is compared by handle, and the bodies of
+	// the sources
+	const Handle _premise;
+	Handle _clause;
+	const HandleSet& _bodies;
+
+	const FocusSet* _focus_set;
+
+	// Body grounding the clause in the current grounding
+	Handle _body;
+
+	std::map<Handle, HandleSeq> _products;
+
+	size_t _clause_match_count;
+};
+
+} // ~namespace opencog
+
+#endif /* _OPENCOG_BATCHPMCB_H_ */
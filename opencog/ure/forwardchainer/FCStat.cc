@@ -26,31 +26,192 @@
 
 using namespace opencog;
 
-void FCStat::add_inference_record(unsigned iteration, Handle source,
+// Source of the unique ids of FCStat objects
+static std::atomic<size_t> fcstat_count{0};
+
+FCStat::FCStat(AtomSpace* trace_as)
+	: _id(fcstat_count++), _trace_as(trace_as)
+{
+	if (_trace_as)
+		_trace_writer.reset(new TraceWriter(*_trace_as));
+}
+
+void FCStat::set_log_size(int log_size)
+{
+	_log_size = log_size;
+}
+
+void FCStat::add_inference_record(unsigned iteration, const Source& source,
                                   const Rule& rule,
                                   const HandleSet& product)
 {
+	Handle schema = rule.get_alias();
+	add_source(source);
+	unsigned rule_index = get_rule_index(schema);
+	std::vector<size_t> product_ids;
+	product_ids.reserve(product.size());
+	for (const Handle& h : product)
+		product_ids.push_back(get_product_id(h));
 	{
-		std::lock_guard<std::mutex> lock(_whole_mutex);
-		_inf_rec.emplace_back(source, rule, product);
+		Segment& segment = local_segment();
+		std::lock_guard<std::mutex> lock(segment.mutex);
+		segment.iterations.push_back(iteration);
+		segment.sources.push_back(source.id);
+		segment.rules.push_back(rule_index);
+		segment.product_sizes.push_back(product_ids.size());
+		segment.products.insert(segment.products.end(),
+		                        product_ids.begin(), product_ids.end());
+		int log_size = _log_size;
+		while (0 <= log_size and (size_t)log_size < segment.iterations.size())
+			segment.pop_front();
+	}
+	_record_count++;
+
+	// The trace links are built by the writer thread
+	if (_trace_writer and not product.empty())
+		_trace_writer->write_executions(schema, {source.body},
+		                                HandleSeq(product.begin(), product.end()),
+		                                nullptr, iteration + 1);
+}
+
+void FCStat::flush()
+{
+	if (_trace_writer)
+		_trace_writer->flush();
+}
+
+HandleSet FCStat::get_all_products() const
+{
+	HandleSet all_products;
+	for (const ProductShard& shard : _product_shards) {
+		std::shared_lock<std::shared_mutex> lock(shard.mutex);
+		all_products.insert(shard.products.begin(), shard.products.end());
 	}
+	return all_products;
+}
 
-	if (_trace_as and not product.empty()) {
-		Handle schema = rule.get_alias();
-		Handle i = _trace_as->add_node(NUMBER_NODE, std::to_string(iteration + 1));
-		Handle inputs = _trace_as->add_link(LIST_LINK, source, i);
-		for (const Handle& output : product) {
-			_trace_as->add_link(EXECUTION_LINK, schema, inputs, output);
+std::vector<InferenceRecord> FCStat::get_inference_records() const
+{
+	std::vector<InferenceRecord> records;
+	std::shared_lock<std::shared_mutex> segments_lock(_segments_mutex);
+	std::shared_lock<std::shared_mutex> ids_lock(_ids_mutex);
+	for (const auto& tid_segment : _segments) {
+		const Segment& segment = *tid_segment.second;
+		std::lock_guard<std::mutex> lock(segment.mutex);
+		auto product_it = segment.products.begin();
+		for (size_t i = 0; i < segment.iterations.size(); i++) {
+			HandleSeq product;
+			for (unsigned j = 0; j < segment.product_sizes[i]; j++)
+				product.push_back(get_product(*product_it++));
+			records.push_back({segment.iterations[i],
+			                   _source_bodies[segment.sources[i]],
+			                   _rule_aliases[segment.rules[i]],
+			                   product});
 		}
 	}
+	return records;
 }
 
-HandleSet FCStat::get_all_products() const
+size_t FCStat::get_inference_record_count() const
+{
+	return _record_count;
+}
+
+void FCStat::add_pm_execution(size_t matches)
+{
+	_pm_executions++;
+	_pm_matches += matches;
+}
+
+size_t FCStat::get_pm_executions() const
+{
+	return _pm_executions;
+}
+
+size_t FCStat::get_pm_matches() const
+{
+	return _pm_matches;
+}
+
+void FCStat::Segment::pop_front()
+{
+	unsigned n = product_sizes.front();
+	products.erase(products.begin(), std::next(products.begin(), n));
+	iterations.pop_front();
+	sources.pop_front();
+	rules.pop_front();
+	product_sizes.pop_front();
+}
+
+FCStat::Segment& FCStat::local_segment()
+{
+	// Segment of the calling thread in the last FCStat it has
+	// recorded into, so that finding it is lock free in the common
+	// case. Ids are never reused, thus the cache cannot point to the
+	// segment of a destroyed FCStat.
+	static thread_local size_t cached_id = -1;
+	static thread_local Segment* cached_segment = nullptr;
+	if (cached_id == _id)
+		return *cached_segment;
+
+	std::unique_lock<std::shared_mutex> lock(_segments_mutex);
+	std::unique_ptr<Segment>& segment = _segments[std::this_thread::get_id()];
+	if (not segment)
+		segment.reset(new Segment());
+	cached_id = _id;
+	cached_segment = segment.get();
+	return *cached_segment;
+}
+
+void FCStat::add_source(const Source& source)
+{
+	{
+		std::shared_lock<std::shared_mutex> lock(_ids_mutex);
+		if (source.id < _source_bodies.size() and _source_bodies[source.id])
+			return;
+	}
+	std::unique_lock<std::shared_mutex> lock(_ids_mutex);
+	if (_source_bodies.size() <= source.id)
+		_source_bodies.resize(source.id + 1);
+	_source_bodies[source.id] = source.body;
+}
+
+unsigned FCStat::get_rule_index(const Handle& alias)
 {
-	std::lock_guard<std::mutex> lock(_whole_mutex);
-	HandleSet all;
-	for(const auto& ir : _inf_rec)
-		all.insert(ir.product.begin(),ir.product.end());
+	{
+		std::shared_lock<std::shared_mutex> lock(_ids_mutex);
+		auto it = _rule_indices.find(alias);
+		if (it != _rule_indices.end())
+			return it->second;
+	}
+	std::unique_lock<std::shared_mutex> lock(_ids_mutex);
+	auto it = _rule_indices.emplace(alias, _rule_aliases.size()).first;
+	if (it->second == _rule_aliases.size())
+		_rule_aliases.push_back(alias);
+	return it->second;
+}
 
-	return all;
+size_t FCStat::get_product_id(const Handle& product)
+{
+	size_t shard_index = product->get_hash() % product_shard_count;
+	ProductShard& shard = _product_shards[shard_index];
+	{
+		std::shared_lock<std::shared_mutex> lock(shard.mutex);
+		auto it = shard.ids.find(product);
+		if (it != shard.ids.end())
+			return it->second;
+	}
+	std::unique_lock<std::shared_mutex> lock(shard.mutex);
+	size_t id = shard.products.size() * product_shard_count + shard_index;
+	auto it = shard.ids.emplace(product, id).first;
+	if (it->second == id)
+		shard.products.push_back(product);
+	return it->second;
+}
+
+Handle FCStat::get_product(size_t id) const
+{
+	const ProductShard& shard = _product_shards[id % product_shard_count];
+	std::shared_lock<std::shared_mutex> lock(shard.mutex);
+	return shard.products[id / product_shard_count];
 }
@@ -20,31 +20,65 @@
  * Free Software Foundation, Inc.,
  * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
  */
-
 #ifndef _OPENCOG_FCSTAT_H_
 #define _OPENCOG_FCSTAT_H_
 
+#include <array>
+#include <atomic>
+#include <deque>
 #include <map>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
 
 #include <opencog/atoms/base/Handle.h>
 #include <opencog/ure/Rule.h>
+#include <opencog/ure/TraceWriter.h>
+#include <opencog/ure/forwardchainer/SourceSet.h>
 
 namespace opencog {
 
+/**
+ * Inference record, as returned by FCStat::get_inference_records.
+ * The rule is represented by its alias.
+ */
 struct InferenceRecord
 {
-	const Handle hsource;
-	const Rule& rule;
-	HandleSet product;
-
-	InferenceRecord(Handle h, const Rule& r, const HandleSet& p)
-		: hsource(h), rule(r), product(p) {}
+	unsigned iteration;
+	Handle source;
+	Handle rule;
+	HandleSeq product;
 };
 
+/**
+ * Log of the inferences of the forward chainer.
+ *
+ * Records are appended to a segment owned by the recording thread,
+ * so that threads do not contend with each other. A segment stores
+ * records column-wise, as dense ids rather than atoms, the source
+ * id, the rule index and the product ids, the products of all its
+ * records being stored contiguously alongside the number of products
+ * of each record. If a log size is set, the oldest records of a
+ * segment are discarded beyond it, like a ring buffer.
+ *
+ * The set of all products is maintained incrementally, regardless of
+ * the log size, sharded by product hash so that threads recording
+ * different products rarely contend. Products are given ids by their
+ * shard.
+ */
 class FCStat
 {
 public:
-	FCStat(AtomSpace* trace_as) : _trace_as(trace_as) {}
+	FCStat(AtomSpace* trace_as);
+
+	/**
+	 * Set the maximum number of records retained per segment.
+	 * Negative means unlimited.
+	 */
+	void set_log_size(int log_size);
 
 	/**
 	 * Record the inference step into memory, as well as in the
@@ -61,20 +95,124 @@ public:
 	 *
 	 * 1. <rule> is DefinedSchemaNode <rule-name>
 	 * 2. <step> is NumberNode <#iteration>
-	 * 3. <source> is the source
+	 * 3. <source> is the body of the source
 	 * 4. <product> is a SetLink <p1> ... <pn> where pi are the products
+	 *
+	 * Records are written into the atomspace asynchronously, see
+	 * flush.
 	 */
-	void add_inference_record(unsigned iteration, Handle source,
+	void add_inference_record(unsigned iteration, const Source& source,
 	                          const Rule& rule, const HandleSet& product);
 	HandleSet get_all_products() const;
-	HandleSet get_all_products();
+
+	/**
+	 * Wait till all records have been written into the trace
+	 * atomspace, if any.
+	 */
+	void flush();
+
+	/**
+	 * Return the retained inference records, in order of insertion
+	 * within each segment.
+	 */
+	std::vector<InferenceRecord> get_inference_records() const;
+
+	/**
+	 * Number of inference records added so far, including discarded
+	 * ones.
+	 */
+	size_t get_inference_record_count() const;
+
+	/**
+	 * Record a pattern matcher execution of a rule, and the number of
+	 * matches it has returned.
+	 */
+	void add_pm_execution(size_t matches);
+	size_t get_pm_executions() const;
+	size_t get_pm_matches() const;
 
 private:
-	std::vector<InferenceRecord> _inf_rec;
+	struct Segment
+	{
+		// One element per record, the source id and rule index
+		std::deque<unsigned> iterations;
+		std::deque<size_t> sources;
+		std::deque<unsigned> rules;
+		std::deque<unsigned> product_sizes;
+
+		// Product ids of all records, in the same order
+		std::deque<size_t> products;
+
+		// Only contended by readers
+		mutable std::mutex mutex;
+
+		/**
+		 * Discard the oldest record.
+		 */
+		void pop_front();
+	};
+
+	// Shard of the set of all products
+	struct ProductShard
+	{
+		std::unordered_map<Handle, size_t> ids;
+		HandleSeq products;
+		mutable std::shared_mutex mutex;
+	};
+	static const size_t product_shard_count = 16;
+
+	/**
+	 * Return the segment of the calling thread, creating it if
+	 * needed.
+	 */
+	Segment& local_segment();
+
+	/**
+	 * Register the body of the source, if not already, under its id.
+	 */
+	void add_source(const Source& source);
+
+	/**
+	 * Return the index of the rule alias, registering it if needed.
+	 */
+	unsigned get_rule_index(const Handle& alias);
+
+	/**
+	 * Return the id of the product, inserting it in its shard if
+	 * needed. The id is the index of the product in its shard times
+	 * the number of shards, plus the index of its shard.
+	 */
+	size_t get_product_id(const Handle& product);
+	Handle get_product(size_t id) const;
+
+	// Unique id of this object, used to cache the segment of each
+	// thread without the risk of confusing it with the one of a
+	// destroyed FCStat.
+	const size_t _id;
+
+	std::map<std::thread::id, std::unique_ptr<Segment>> _segments;
+	mutable std::shared_mutex _segments_mutex;
+
 	AtomSpace* _trace_as;
 
-	// TODO: subdivide in smaller and shared mutexes
-	mutable std::mutex _whole_mutex;
+	// Write records into _trace_as in the background. Null if there
+	// is no trace atomspace.
+	std::unique_ptr<TraceWriter> _trace_writer;
+
+	std::atomic<int> _log_size{-1};
+	std::atomic<size_t> _record_count{0};
+
+	// Source bodies by source id, and rule aliases by rule index
+	HandleSeq _source_bodies;
+	HandleSeq _rule_aliases;
+	std::map<Handle, unsigned> _rule_indices;
+	mutable std::shared_mutex _ids_mutex;
+
+	std::array<ProductShard, product_shard_count> _product_shards;
+
+	// Pattern matcher counters
+	std::atomic<size_t> _pm_executions{0};
+	std::atomic<size_t> _pm_matches{0};
 };
 
 }
@@ -0,0 +1,142 @@
+/*
+ * FocusSet.cc
+ *
+ * Copyright (C) 2020 SingularityNET Foundation
+ *
+ * Authors: Nil Geisweiller
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License v3 as
+ * published by the Free Software Foundation and including the exceptions
+ * at http://opencog.org/wiki/Licenses
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program; if not, write to:
+ * Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "FocusSet.h"
+
+#include <sstream>
+
+#include <opencog/atoms/atom_types/NameServer.h>
+#include <opencog/query/PatternMatchEngine.h>
+
+namespace opencog {
+
+FocusSet::FocusSet()
+{
+}
+
+void FocusSet::insert(const Handle& h)
+{
+	std::unique_lock<std::shared_mutex> lock(_mutex);
+	insert_rec(h);
+}
+
+void FocusSet::insert_rec(const Handle& h)
+{
+	// Outgoing atoms of an already indexed atom are indexed as well
+	if (not _atoms.insert(h).second)
+		return;
+	_atoms_by_type[h->get_type()].push_back(h);
+	if (h->is_link())
+		for (const Handle& child : h->getOutgoingSet())
+			insert_rec(child);
+}
+
+bool FocusSet::contains(const Handle& h) const
+{
+	std::shared_lock<std::shared_mutex> lock(_mutex);
+	return _atoms.find(h) != _atoms.end();
+}
+
+HandleSeq FocusSet::get_atoms(Type type) const
+{
+	std::shared_lock<std::shared_mutex> lock(_mutex);
+	auto it = _atoms_by_type.find(type);
+	return it == _atoms_by_type.end() ? HandleSeq() : it->second;
+}
+
+bool FocusSet::empty() const
+{
+	std::shared_lock<std::shared_mutex> lock(_mutex);
+	return _atoms.empty();
+}
+
+size_t FocusSet::size() const
+{
+	std::shared_lock<std::shared_mutex> lock(_mutex);
+	return _atoms.size();
+}
+
+std::string FocusSet::to_string(const std::string& indent) const
+{
+	std::shared_lock<std::shared_mutex> lock(_mutex);
+	std::stringstream ss;
+	ss << indent << "size = " << _atoms.size();
+	return ss.str();
+}
+
+FocusSetPMCB::FocusSetPMCB(AtomSpace* kb_as, const FocusSet& focus_set)
+	: Implicator(kb_as),
+	  InitiateSearchCB(kb_as),
+	  DefaultPatternMatchCB(kb_as),
+	  DefaultImplicator(kb_as),
+	  _focus_set(focus_set)
+{
+}
+
+bool FocusSetPMCB::perform_search(PatternMatchCallback& pmc)
+{
+	// Start from the clause with the fewest candidate groundings in
+	// the focus set. Bare variables, quotations and evaluatable
+	// clauses are ignored as their groundings cannot be enumerated
+	// by type.
+	Handle start;
+	HandleSeq candidates;
+	for (const Handle& clause : _pattern->mandatory) {
+		Type t = clause->get_type();
+		if (t == VARIABLE_NODE or t == GLOB_NODE or
+		    t == QUOTE_LINK or t == LOCAL_QUOTE_LINK or
+		    nameserver().isA(t, EVALUATABLE_LINK))
+			continue;
+		HandleSeq atoms = _focus_set.get_atoms(t);
+		if (not start or atoms.size() < candidates.size()) {
+			start = clause;
+			candidates = std::move(atoms);
+		}
+	}
+	if (not start)
+		return DefaultImplicator::perform_search(pmc);
+
+	// Any grounding of the pattern grounds the start clause to an
+	// atom of the focus set, explore from each of them.
+	PatternMatchEngine pme(pmc);
+	pme.set_pattern(*_variables, *_pattern);
+	for (const Handle& h : candidates)
+		if (pme.explore_neighborhood(start, start, h))
+			return true;
+	return false;
+}
+
+bool FocusSetPMCB::clause_match(const Handle& ptrn,
+                                const Handle& grnd,
+                                const GroundingMap& term_gnds)
+{
+	return _focus_set.contains(grnd)
+		and DefaultImplicator::clause_match(ptrn, grnd, term_gnds);
+}
+
+std::string oc_to_string(const FocusSet& fs, const std::string& indent)
+{
+	return fs.to_string(indent);
+}
+
+} // ~namespace opencog
@@ -0,0 +1,110 @@
+/*
+ * FocusSet.h
+ *
+ * Copyright (C) 2020 SingularityNET Foundation
+ *
+ * Authors: Nil Geisweiller
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License v3 as
+ * published by the Free Software Foundation and including the exceptions
+ * at http://opencog.org/wiki/Licenses
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License
+ * along with this program; if not, write to:
+ * Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+#ifndef _OPENCOG_FOCUSSET_H_
+#define _OPENCOG_FOCUSSET_H_
+
+#include <map>
+#include <shared_mutex>
+
+#include <opencog/util/empty_string.h>
+#include <opencog/atomspace/AtomSpace.h>
+#include <opencog/query/DefaultImplicator.h>
+
+namespace opencog
+{
+
+/**
+ * Membership index of the atoms under focus, layered over the
+ * knowledge base atomspace. Atoms are not copied, only their handles
+ * are indexed, alongside the handles of their outgoing atoms, as
+ * these are reachable by the pattern matcher as well.
+ */
+class FocusSet
+{
+public:
+	FocusSet();
+
+	/**
+	 * Insert an atom, and recursively its outgoing atoms, in the
+	 * index.
+	 */
+	void insert(const Handle& h);
+
+	/**
+	 * Return true iff the atom is in the index.
+	 */
+	bool contains(const Handle& h) const;
+
+	/**
+	 * Return the atoms of the index of the given type.
+	 */
+	HandleSeq get_atoms(Type type) const;
+
+	bool empty() const;
+	size_t size() const;
+
+	std::string to_string(const std::string& indent=empty_string) const;
+
+private:
+	void insert_rec(const Handle& h);
+
+	HandleSet _atoms;
+
+	// Atoms of the index by type, to enumerate the candidate
+	// groundings of a clause.
+	std::map<Type, HandleSeq> _atoms_by_type;
+
+	// Products are inserted while pattern matcher callbacks of other
+	// threads read the index.
+	mutable std::shared_mutex _mutex;
+};
+
+/**
+ * Pattern matcher callback over the knowledge base atomspace,
+ * restricted to the focus set. The search starts from the atoms of
+ * the focus set grounding the most selective clause, rather than from
+ * the indexes of the whole knowledge base, and any clause whose
+ * grounding is outside of the focus set is rejected, so that the
+ * search is pruned as soon as it leaves it.
+ */
+class FocusSetPMCB : public virtual DefaultImplicator
+{
+public:
+	FocusSetPMCB(AtomSpace* kb_as, const FocusSet& focus_set);
+
+	virtual bool perform_search(PatternMatchCallback& pmc);
+
+	virtual bool clause_match(const Handle& ptrn,
+	                          const Handle& grnd,
+	                          const GroundingMap& term_gnds);
+
+private:
+	const FocusSet& _focus_set;
+};
+
+std::string oc_to_string(const FocusSet& fs,
+                         const std::string& indent=empty_string);
+
+} // ~namespace opencog
+
+#endif /* _OPENCOG_FOCUSSET_H_ */
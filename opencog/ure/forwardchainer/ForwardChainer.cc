@@ -24,21 +24,21 @@
  */
 
 #include <future>
-#include <thread>
-#include <chrono>
 
 #include <boost/range/adaptor/reversed.hpp>
+#include <boost/range/algorithm_ext/erase.hpp>
 
 #include <opencog/util/random.h>
-#include <opencog/util/pool.h>
 #include <opencog/atoms/core/VariableList.h>
 #include <opencog/atoms/core/FindUtils.h>
 #include <opencog/atoms/pattern/BindLink.h>
 #include <opencog/atoms/pattern/PatternUtils.h>
 #include <opencog/atoms/truthvalue/TruthValue.h>
+#include <opencog/unify/Unify.h>
 #include <opencog/ure/Rule.h>
 
 #include "ForwardChainer.h"
+#include "BatchPMCB.h"
 #include "../URELogger.h"
 #include "../backwardchainer/ControlPolicy.h"
 #include "../ThompsonSampling.h"
@@ -55,10 +55,13 @@ ForwardChainer::ForwardChainer(AtomSpace& kb_as,
 	: _kb_as(kb_as),
 	  _rb_as(rb_as),
 	  _config(rb_as, rbs),
-	  _thread_count(0),
+	  _budget(_config),
+	  _seed(0),
 	  _sources(_config, source, vardecl),
 	  _fcstat(trace_as),
-	  _srpi(true)
+	  _produced_connection(-1),
+	  _srpi(true),
+	  _next_subscription_id(0)
 {
 	init(source, vardecl, focus_set);
 }
@@ -77,6 +80,7 @@ ForwardChainer::ForwardChainer(AtomSpace& kb_as,
 
 ForwardChainer::~ForwardChainer()
 {
+	stop_recording_produced();
 }
 
 void ForwardChainer::init(const Handle& source,
@@ -87,20 +91,28 @@ void ForwardChainer::init(const Handle& source,
 
 	_search_focus_set = not focus_set.empty();
 
-	// Add focus set atoms and sources to focus_set atomspace
+	// Index focus set atoms and sources. They are added to the
+	// knowledge base atomspace in case they are not already there,
+	// which is a mere lookup otherwise.
 	if (_search_focus_set) {
 		for (const Handle& h : focus_set)
-			_focus_set_as.add_atom(h);
+			_focus_set.insert(_kb_as.add_atom(h));
 		for (const SourcePtr& src : _sources.sources)
-			_focus_set_as.add_atom(src->body);
+			_focus_set.insert(_kb_as.add_atom(src->body));
 	}
 
 	// Set rules.
-	_rules = _config.get_rules();
+	auto rules = std::make_shared<RuleSet>(_config.get_rules());
 	// TODO: For now the FC follows the old standard. We may move to
 	// the new standard when all rules have been ported to the new one.
-	for (RulePtr rule : _rules)
+	for (RulePtr rule : *rules)
 		rule->premises_as_clauses = true;
+	_rules = rules;
+	_rules_generation = 0;
+	_meta_rules_expanded = false;
+	_meta_rules_delta_begin = 0;
+	_produced_begin = 0;
+	_max_produced = 10000;
 
 	// Reset the iteration count
 	_iteration = 0;
@@ -119,24 +131,44 @@ const UREConfig& ForwardChainer::get_config() const
 void ForwardChainer::do_chain()
 {
 	ure_logger().debug("Start forward chaining");
-	LAZY_URE_LOG_DEBUG << "With rule set:" << std::endl << oc_to_string(_rules);
+	LAZY_URE_LOG_DEBUG << "With rule set:" << std::endl
+	                   << oc_to_string(*get_rules());
+
+	_budget.start();
+	_seed = ure_seed(_config);
+	LAZY_URE_LOG_DEBUG << "Random seed: " << _seed;
+	_fcstat.set_log_size(_config.get_inference_log_size());
+
+	// Record the atoms added to the knowledge base, only needed to
+	// build deltas
+	if (_config.get_semi_naive() or get_rules()->has_meta_rules())
+		start_recording_produced();
 
 	// Relex2Logic uses this. TODO make a separate class to handle
 	// this robustly.
 	if(_sources.empty())
 	{
 		apply_all_rules();
+		stop_recording_produced();
+		_fcstat.flush();
 		return;
 	}
 
-	if (_srpi)
-	{
-		do_steps_srpi();
+	// Build the alpha network and push the initial sources through it
+	if (_config.get_match_network()) {
+		_alpha_network.reset(new AlphaNetwork());
+		update_alpha_network();
+	} else {
+		_alpha_network.reset();
 	}
-	else if (_config.get_jobs() <= 1)
+
+	if (_config.get_jobs() <= 1)
 	{
 		// Do steps single-threadedly till termination
-		do_steps_singlethread();
+		if (_srpi)
+			do_steps_srpi();
+		else
+			do_steps_singlethread();
 	} else
 	{
 		// Set log thread ID if multi-threaded
@@ -144,12 +176,20 @@ void ForwardChainer::do_chain()
 		ure_logger().set_thread_id_flag(true);
 
 		// Do steps multi-threadedly till termination
-		do_steps_multithread();
+		if (_srpi)
+			do_steps_srpi_multithread();
+		else
+			do_steps_multithread();
 
 		// Restore logging thread ID flag
 		ure_logger().set_thread_id_flag(prev_thread_id);
 	}
 
+	stop_recording_produced();
+
+	// Make sure the traces are in the trace atomspace
+	_fcstat.flush();
+
 	// Log termination messages
 	termination_log();
 	LAZY_URE_LOG_DEBUG << "Finished forward chaining with results:"
@@ -161,37 +201,52 @@ void ForwardChainer::do_steps_singlethread()
 	while (not termination()) do_step(_iteration++);
 }
 
-// TODO: if creating/destroying threads is too expensive, use a thread
-// pool (see boost::asio::thread_pool).
 void ForwardChainer::do_steps_multithread()
 {
-	// Create a pool of iterations
-	opencog::pool<int> itrpool;
+	run_steppers([&](int iteration) { do_step(iteration); });
+}
 
-	// Run steps in parallel
-	while (not termination())
-	{
-		if (_thread_count < _config.get_jobs())
-			itrpool.give_back(_iteration++);
+void ForwardChainer::run_steppers(const std::function<void(int)>& step)
+{
+	ThreadPool& pool = get_thread_pool();
 
-		int local_iteration = itrpool.borrow();
-		if (local_iteration < 0)
-			// A negative iteration resource is freed to unstuck the main
-			// thread and indicates that the process has terminated.
-			break;
+	// Each stepper claims and runs iterations till termination
+	auto stepper = [&]() {
+		int iteration;
+		while (not termination() and 0 <= (iteration = claim_iteration()))
+			step(iteration);
+	};
 
-		_thread_count++;
-		auto do_step_manage = [=,&itrpool]() {
-			do_step(local_iteration);
-			itrpool.give_back(termination() ? -1 : _iteration++);
-			_thread_count--; };
-		auto thrd = std::thread(do_step_manage);
-		thrd.detach();
-	}
+	// Run as many steppers as jobs
+	std::vector<std::future<void>> steppers;
+	for (int i = 0; i < _config.get_jobs(); i++)
+		steppers.push_back(pool.submit(stepper));
+
+	// Wait for all steppers to terminate, then rethrow their
+	// exception if any
+	for (std::future<void>& s : steppers)
+		s.wait();
+	for (std::future<void>& s : steppers)
+		s.get();
+}
 
-	// Wait for the remaining threads to terminate
-	using namespace std::chrono_literals;
-	while (0 < _thread_count) std::this_thread::sleep_for(1ms);
+ThreadPool& ForwardChainer::get_thread_pool()
+{
+	unsigned jobs = std::max(1, _config.get_jobs());
+	if (not _thread_pool or _thread_pool->size() != jobs)
+		_thread_pool.reset(new ThreadPool(jobs));
+	return *_thread_pool;
+}
+
+int ForwardChainer::claim_iteration()
+{
+	int max_iter = _config.get_maximum_iterations();
+	int iteration = _iteration;
+	do {
+		if (0 <= max_iter and max_iter <= iteration)
+			return -1;
+	} while (not _iteration.compare_exchange_weak(iteration, iteration + 1));
+	return iteration;
 }
 
 void ForwardChainer::do_steps_srpi()
@@ -199,6 +254,83 @@ void ForwardChainer::do_steps_srpi()
 	while (not termination()) do_step_srpi(_iteration++);
 }
 
+void ForwardChainer::do_steps_srpi_multithread()
+{
+	ThreadPool& pool = get_thread_pool();
+	while (not termination()) {
+		// Select the pairs of the iterations of the round on this
+		// thread, in iteration order
+		std::vector<int> iterations;
+		std::vector<std::string> msgprfxs;
+		std::vector<SourceRuleBatch> slc_batches;
+		for (int k = 0; k < _config.get_jobs() and not termination(); k++) {
+			int iteration = _iteration++;
+			std::string msgprfx =
+				std::string("[I-") + std::to_string(iteration + 1) + "] ";
+			iterations.push_back(iteration);
+			msgprfxs.push_back(msgprfx);
+			slc_batches.push_back(select_step_srpi(iteration, msgprfx));
+		}
+
+		// Apply them in parallel, each against its own child
+		// atomspace, so that no application sees the products of
+		// another one of the same round. Semi-naive applications
+		// claim the deltas of their rules, they are run on this
+		// thread, in iteration order, while the others are running.
+		size_t n = slc_batches.size();
+		std::vector<std::unique_ptr<AtomSpace>> round_ases;
+		std::vector<std::vector<SourceRule>> slc_srss(n);
+		std::vector<std::future<std::vector<HandleSet>>> futures(n);
+		std::vector<std::vector<HandleSet>> products(n);
+		std::vector<bool> sequential(n, false);
+		for (size_t k = 0; k < n; k++) {
+			round_ases.emplace_back(new AtomSpace(&_kb_as));
+			for (const auto& sr_tv : slc_batches[k]) {
+				slc_srss[k].push_back(sr_tv.first);
+				sequential[k] = sequential[k] or (_config.get_semi_naive()
+				                                  and is_base_rule(*sr_tv.first.rule));
+			}
+			if (not slc_srss[k].empty() and not sequential[k]) {
+				AtomSpace* ref_as = round_ases[k].get();
+				const std::vector<SourceRule>* srs = &slc_srss[k];
+				futures[k] = pool.submit([this, srs, ref_as]() {
+						return apply_rules(*srs, *ref_as); });
+			}
+		}
+		for (size_t k = 0; k < n; k++)
+			if (sequential[k])
+				products[k] = apply_rules(slc_srss[k], *round_ases[k]);
+		for (size_t k = 0; k < n; k++)
+			if (futures[k].valid())
+				futures[k].wait();
+		for (size_t k = 0; k < n; k++)
+			if (futures[k].valid())
+				products[k] = futures[k].get();
+
+		// Move the products to the knowledge base and merge them, in
+		// iteration order
+		for (size_t k = 0; k < n; k++) {
+			if (slc_batches[k].empty()) {
+				LAZY_URE_LOG_DEBUG << msgprfxs[k]
+				                   << "Failed to select a source rule pair, "
+				                   << "abort iteration";
+				continue;
+			}
+			for (HandleSet& ps : products[k]) {
+				HandleSet kb_ps;
+				for (const Handle& h : ps)
+					kb_ps.insert(_kb_as.add_atom(h));
+				if (_search_focus_set)
+					for (const Handle& h : kb_ps)
+						_focus_set.insert(h);
+				ps = kb_ps;
+			}
+			merge_step_srpi(iterations[k], msgprfxs[k], slc_batches[k],
+			                products[k]);
+		}
+	}
+}
+
 void ForwardChainer::do_step(int iteration)
 {
 	int lipo = iteration + 1;
@@ -210,8 +342,11 @@ void ForwardChainer::do_step(int iteration)
 	// the select_rule method, but for now it's here
 	expand_meta_rules(msgprfx);
 
+	// Draw from the substream of that iteration
+	RandGen rng = ure_substream(_seed, iteration);
+
 	// Select source
-	SourcePtr source = select_source(msgprfx);
+	SourcePtr source = select_source(msgprfx, rng);
 	if (source) {
 		LAZY_URE_LOG_DEBUG << msgprfx << "Selected source:" << std::endl
 		                   << source->to_string();
@@ -221,7 +356,7 @@ void ForwardChainer::do_step(int iteration)
 	}
 
 	// Select rule
-	RuleProbabilityPair rule_prob = select_rule(*source, msgprfx);
+	RuleProbabilityPair rule_prob = select_rule(*source, msgprfx, rng);
 	RulePtr rule = rule_prob.first;
 	double prob(rule_prob.second);
 	if (not rule->is_valid()) {
@@ -244,7 +379,8 @@ void ForwardChainer::do_step(int iteration)
 		source->set_rule_exhausted(rule);
 
 		// Save trace and results
-		_fcstat.add_inference_record(iteration, source->body, *rule, products);
+		_fcstat.add_inference_record(iteration, *source, *rule, products);
+		notify_products(source->body, *rule, products);
 	} else {
 		LAZY_URE_LOG_DEBUG << msgprfx << "Rule " << rule->to_short_string()
 		                   << " is probably being applied on source "
@@ -257,6 +393,30 @@ void ForwardChainer::do_step_srpi(int iteration)
 {
 	int lipo = iteration + 1;
 	std::string msgprfx = std::string("[I-") + std::to_string(lipo) + "] ";
+
+	// Select source rule pairs for application, all sharing the
+	// same base rule
+	SourceRuleBatch slc_batch = select_step_srpi(iteration, msgprfx);
+	if (not slc_batch.empty()) {
+		std::vector<SourceRule> slc_srs;
+		for (const auto& sr_tv : slc_batch)
+			slc_srs.push_back(sr_tv.first);
+
+		// Apply selected source rule pairs
+		std::vector<HandleSet> products = apply_rules(slc_srs);
+
+		merge_step_srpi(iteration, msgprfx, slc_batch, products);
+	} else {
+		LAZY_URE_LOG_DEBUG << msgprfx
+		                   << "Failed to select a source rule pair, "
+		                   << "abort iteration";
+	}
+}
+
+ForwardChainer::SourceRuleBatch
+ForwardChainer::select_step_srpi(int iteration, const std::string& msgprfx)
+{
+	int lipo = iteration + 1;
 	ure_logger().debug() << msgprfx << "Start iteration (" << lipo
 	                     << "/" << _config.get_maximum_iterations_str() << ")";
 
@@ -264,20 +424,31 @@ void ForwardChainer::do_step_srpi(int iteration)
 	// the select_rule method, but for now it's here.
 	expand_meta_rules(msgprfx);
 
+	// Draw from the substream of that iteration
+	RandGen rng = ure_substream(_seed, iteration);
+
 	// Populate the source rule set
-	populate_source_rule_set(msgprfx);
+	populate_source_rule_set(msgprfx, rng);
 
-	// Select source rule pair for application
-	auto [slc_sr, slc_tv] = select_source_rule(msgprfx);
-	if (slc_sr.is_valid()) {
-		double success_plty = BetaDistribution(slc_tv).mean();
+	// Select source rule pairs for application, all sharing the
+	// same base rule
+	SourceRuleBatch slc_batch = select_source_rules(msgprfx, rng);
+	for (const auto& sr_tv : slc_batch)
 		LAZY_URE_LOG_DEBUG << msgprfx
 		                   << "Selected source rule pair with probability "
-								 << success_plty << " of success:" << std::endl
-		                   << oc_to_string(slc_sr);
+		                   << BetaDistribution(sr_tv.second).mean()
+		                   << " of success:" << std::endl
+		                   << oc_to_string(sr_tv.first);
+	return slc_batch;
+}
 
-		// Apply selected source rule pair
-		HandleSet products = apply_rule(slc_sr);
+void ForwardChainer::merge_step_srpi(int iteration, const std::string& msgprfx,
+                                     const SourceRuleBatch& slc_batch,
+                                     const std::vector<HandleSet>& products)
+{
+	// Dispatch the products to their source rule pairs
+	for (size_t i = 0; i < slc_batch.size(); i++) {
+		const auto& [slc_sr, slc_tv] = slc_batch[i];
 
 		// Insert the produced sources in the population of sources
 		//
@@ -287,20 +458,27 @@ void ForwardChainer::do_step_srpi(int iteration)
 		//
 		// TODO: This can be simplified but is let here until do_step is
 		// replaced by do_step_srpi.
+		double success_plty = BetaDistribution(slc_tv).mean();
 		double weight = std::min(1.0, slc_sr.source->weight);
 		double prob = success_plty / weight;
-		_sources.insert(products, *slc_sr.source, prob, msgprfx);
+		std::vector<size_t> evicted;
+		SourceSet::Sources new_srcs =
+			_sources.insert(products[i], *slc_sr.source, prob, msgprfx,
+			                &evicted);
+		erase_sources(evicted);
+
+		// Produce their source rule pairs
+		if (_alpha_network)
+			for (const SourcePtr& new_src : new_srcs)
+				_alpha_network->push(new_src);
 
 		// The rule has been applied, we can set the exhausted flag
 		slc_sr.source->set_rule_exhausted(slc_sr.rule);
 
 		// Save trace and results
-		_fcstat.add_inference_record(iteration, slc_sr.source->body,
-		                             *slc_sr.rule, products);
-	} else {
-		LAZY_URE_LOG_DEBUG << msgprfx
-		                   << "Failed to select a source rule pair, "
-		                   << "abort iteration";
+		_fcstat.add_inference_record(iteration, *slc_sr.source,
+		                             *slc_sr.rule, products[i]);
+		notify_products(slc_sr.source->body, *slc_sr.rule, products[i]);
 	}
 }
 
@@ -309,7 +487,8 @@ bool ForwardChainer::termination()
 	bool terminate = false;
 
 	// Terminate if all source rule pairs have been tried
-	if (_sources.is_exhausted() and _source_rule_set.empty()) {
+	if (_sources.is_exhausted() and _source_rule_set.empty()
+	    and (not _alpha_network or _alpha_network->empty())) {
 		terminate = true;
 	}
 	// Terminate if max iterations has been reached
@@ -317,6 +496,10 @@ bool ForwardChainer::termination()
 	         _config.get_maximum_iterations() <= _iteration) {
 		terminate = true;
 	}
+	// Terminate if the budget is exhausted
+	else if (_budget.is_exhausted()) {
+		terminate = true;
+	}
 
 	return terminate;
 }
@@ -326,7 +509,8 @@ void ForwardChainer::termination_log()
 	std::string msg;
 
 	// Terminate if all sources have been tried
-	if (_sources.is_exhausted() and _source_rule_set.empty()) {
+	if (_sources.is_exhausted() and _source_rule_set.empty()
+	    and (not _alpha_network or _alpha_network->empty())) {
 		msg = "all source rule pairs have been exhausted";
 	}
 	// Terminate if max iterations has been reached
@@ -334,6 +518,10 @@ void ForwardChainer::termination_log()
 	         _config.get_maximum_iterations() <= _iteration) {
 		msg = "reach maximum number of iterations";
 	}
+	// Terminate if the budget is exhausted
+	else {
+		msg = _budget.exhausted_msg();
+	}
 
 	ure_logger().debug() << "Terminate: " << msg;
 }
@@ -343,14 +531,49 @@ void ForwardChainer::termination_log()
  */
 void ForwardChainer::apply_all_rules()
 {
-	for (const RulePtr& rule : _rules) {
+	for (const RulePtr& rule : *get_rules()) {
+		if (_budget.is_exhausted()) {
+			ure_logger().debug() << "Stop applying rules: "
+			                     << _budget.exhausted_msg();
+			break;
+		}
 		ure_logger().debug("Apply rule %s", rule->get_name().c_str());
 		HandleSet uhs = apply_rule(*rule);
 
 		// Update
-		_fcstat.add_inference_record(_iteration,
-		                             _kb_as.add_node(CONCEPT_NODE, "dummy-source"),
-		                             *rule, uhs);
+		// The source set is empty, the dummy source can take the
+		// first id.
+		Source dummy_source(_kb_as.add_node(CONCEPT_NODE, "dummy-source"));
+		dummy_source.id = 0;
+		_fcstat.add_inference_record(_iteration, dummy_source, *rule, uhs);
+		notify_products(dummy_source.body, *rule, uhs);
+	}
+}
+
+void ForwardChainer::notify_products(const Handle& source, const Rule& rule,
+                                     const HandleSet& products)
+{
+	if (products.empty())
+		return;
+
+	// Copy the subscriptions so that callbacks run without holding
+	// the lock, and may thus (un)subscribe.
+	std::vector<Subscription> subscriptions;
+	{
+		std::lock_guard<std::mutex> lock(_subscriptions_mutex);
+		for (const auto& id_sub : _subscriptions)
+			subscriptions.push_back(id_sub.second);
+	}
+
+	for (const Subscription& sub : subscriptions) {
+		for (const Handle& product : products) {
+			if (sub.pattern) {
+				Unify unify(sub.pattern, product, sub.vardecl, Handle::UNDEFINED);
+				if (not unify().is_satisfiable())
+					continue;
+			}
+			sub.callback(product, source, rule);
+		}
 	}
 }
 
@@ -366,16 +589,46 @@ HandleSet ForwardChainer::get_results_set() const
 	return _fcstat.get_all_products();
 }
 
-SourcePtr ForwardChainer::select_source(const std::string& msgprfx)
+const FCStat& ForwardChainer::get_fcstat() const
+{
+	return _fcstat;
+}
+
+int ForwardChainer::get_iteration() const
+{
+	return _iteration;
+}
+
+const SourceSet& ForwardChainer::get_source_set() const
 {
-	// TODO: refine mutex
-	std::unique_lock<std::mutex> lock(_part_mutex);
+	return _sources;
+}
 
-	std::vector<double> weights = _sources.get_weights();
+size_t ForwardChainer::subscribe(const ProductCallback& callback,
+                                 const Handle& pattern,
+                                 const Handle& vardecl)
+{
+	std::lock_guard<std::mutex> lock(_subscriptions_mutex);
+	size_t id = _next_subscription_id++;
+	_subscriptions[id] = {callback, pattern, vardecl};
+	return id;
+}
+
+bool ForwardChainer::unsubscribe(size_t id)
+{
+	std::lock_guard<std::mutex> lock(_subscriptions_mutex);
+	return 0 < _subscriptions.erase(id);
+}
 
+SourcePtr ForwardChainer::select_source(const std::string& msgprfx,
+                                        RandGen& rng)
+{
 	// Debug log
 	if (ure_logger().is_debug_enabled()) {
-		OC_ASSERT(weights.size() == _sources.size());
+		// Take a snapshot of the sources alongside their weights, as
+		// other threads may insert new sources in the meantime.
+		SourceSet::Sources sources;
+		std::vector<double> weights = _sources.get_weights(sources);
 		size_t wi = 0;
 		// Sort sources according to their weights
 		std::multimap<double, Handle> weighted_sources;
@@ -383,7 +636,7 @@ SourcePtr ForwardChainer::select_source(const std::string& msgprfx)
 			if (0 < weights[i]) {
 				wi++;
 				if (ure_logger().is_fine_enabled()) {
-					weighted_sources.insert({weights[i], _sources.sources[i]->body});
+					weighted_sources.insert({weights[i], sources[i]->body});
 				}
 			}
 		}
@@ -397,10 +650,10 @@ SourcePtr ForwardChainer::select_source(const std::string& msgprfx)
 		}
 	}
 
-	// Calculate the total weight to be sure it's greater than zero
-	double total = boost::accumulate(weights, 0.0);
+	// Sample sources according to their weights
+	SourcePtr source = _sources.select(rng);
 
-	if (total == 0.0) {
+	if (not source) {
 		ure_logger().debug() << msgprfx << "All sources have been exhausted";
 		if (_config.get_retry_exhausted_sources()) {
 			ure_logger().debug() << msgprfx
@@ -410,22 +663,20 @@ SourcePtr ForwardChainer::select_source(const std::string& msgprfx)
 			// attempting to apply that rule at the same time.
 			_sources.reset_exhausted();
 			// Try again
-			lock.unlock();
-			return select_source(msgprfx);
+			return select_source(msgprfx, rng);
 		} else {
 			_sources.set_exhausted();
 			return nullptr;
 		}
 	}
 
-	// Sample sources according to this distribution
-	std::discrete_distribution<size_t> dist(weights.begin(), weights.end());
-	return *std::next(_sources.sources.begin(), dist(randGen()));
+	return source;
 }
 
-SourceRule ForwardChainer::mk_source_rule(const std::string& msgprfx)
+SourceRule ForwardChainer::mk_source_rule(const std::string& msgprfx,
+                                          RandGen& rng)
 {
-	SourcePtr source = select_source(msgprfx);
+	SourcePtr source = select_source(msgprfx, rng);
 	if (source) {
 		LAZY_URE_LOG_DEBUG << msgprfx << "Selected source:" << std::endl
 		                   << source->to_string();
@@ -450,12 +701,12 @@ SourceRule ForwardChainer::mk_source_rule(const std::string& msgprfx)
 	if (valid_rules.empty()) {
 		source->set_exhausted();
 		// Try again, in case another source is available
-		return mk_source_rule(msgprfx);
+		return mk_source_rule(msgprfx, rng);
 	}
 
 	// Thompson sample according to rule tvs
 	TruthValueSeq tvs = valid_rules.get_tvs();
-	RulePtr slc_rule = valid_rules[ThompsonSampling(tvs)()];
+	RulePtr slc_rule = valid_rules[ThompsonSampling(tvs)(rng)];
 	bool success = source->insert_rule(slc_rule);
 	if (not success)
 		return SourceRule();
@@ -469,14 +720,75 @@ SourceRule ForwardChainer::mk_source_rule(const std::string& msgprfx)
 	return sr;
 }
 
-void ForwardChainer::populate_source_rule_set(const std::string& msgprfx)
+SourceRule ForwardChainer::pop_activation(const std::string& msgprfx)
+{
+	update_alpha_network();
+
+	unsigned generation = _alpha_network->get_generation();
+	for (SourceRule cand = _alpha_network->pop(); cand.is_valid();
+	     cand = _alpha_network->pop()) {
+		// Skip the candidates of evicted sources, as they may have
+		// been evicted by another thread after being popped
+		if (not _sources.get_source(cand.source->id))
+			continue;
+
+		// The candidate only tells that a premise of the rule may
+		// unify with the source, resolve its specializations, sharing
+		// the cache of get_valid_rules.
+		RuleSet unified_rules =
+			get_unified_rules(*cand.source, cand.rule, generation);
+		for (auto it = unified_rules.begin(); it != unified_rules.end(); ++it) {
+			// Skip the specializations that have already been tried
+			if (not cand.source->insert_rule(*it))
+				continue;
+			cand.source->set_rule_exhausted(*it);
+
+			// Queue the candidate back if other specializations may
+			// remain untried
+			if (std::next(it) != unified_rules.end())
+				_alpha_network->push_front(cand);
+
+			SourceRule sr(cand.source, *it);
+			LAZY_URE_LOG_FINE << msgprfx
+			                  << "Popped activation:" << std::endl
+			                  << sr.to_string();
+			return sr;
+		}
+	}
+	return SourceRule();
+}
+
+void ForwardChainer::update_alpha_network()
+{
+	// Read the generation before the rule set, see get_valid_rules
+	unsigned generation = _rules_generation;
+	if (_alpha_network->compile(*get_rules(), generation))
+		for (const SourcePtr& src : _sources.get_sources())
+			_alpha_network->push(src);
+}
+
+void ForwardChainer::erase_sources(const std::vector<size_t>& source_ids)
+{
+	if (source_ids.empty())
+		return;
+	_source_rule_set.erase_sources(source_ids);
+	if (_alpha_network)
+		_alpha_network->erase_sources(source_ids);
+}
+
+void ForwardChainer::populate_source_rule_set(const std::string& msgprfx,
+                                              RandGen& rng)
 {
 	LAZY_URE_LOG_DEBUG << msgprfx << "Populate the source rule set (size="
 	                   << _source_rule_set.size() << ")";
 	int eps = _config.get_expansion_pool_size();
 	while (eps <= 0 or (int)_source_rule_set.size() < eps) {
-		// Build (source, rule) pair for application trial
-		SourceRule sr = mk_source_rule(msgprfx);
+		// Build (source, rule) pair for application trial, from the
+		// alpha network if any, otherwise by selecting a source and
+		// a rule.
+		SourceRule sr = _alpha_network ? pop_activation(msgprfx) : SourceRule();
+		if (not sr.is_valid())
+			sr = mk_source_rule(msgprfx, rng);
 		if (not sr.is_valid()) {
 			LAZY_URE_LOG_DEBUG << msgprfx
 			                   << "Failed to build a source rule pair, "
@@ -501,9 +813,32 @@ void ForwardChainer::populate_source_rule_set(const std::string& msgprfx)
 }
 
 std::pair<SourceRule, TruthValuePtr>
-ForwardChainer::select_source_rule(const std::string& msgprfx)
+ForwardChainer::select_source_rule(const std::string& msgprfx, RandGen& rng)
 {
-	return _source_rule_set.thompson_select();
+	// Pairs of sources evicted by another thread may not have been
+	// erased yet
+	std::pair<SourceRule, TruthValuePtr> slc;
+	do {
+		slc = _source_rule_set.select(_config.get_source_rule_selection_mode(),
+		                              _config.get_tournament_size(), rng);
+	} while (slc.first.is_valid() and not _sources.get_source(slc.first.source->id));
+	return slc;
+}
+
+std::vector<std::pair<SourceRule, TruthValuePtr>>
+ForwardChainer::select_source_rules(const std::string& msgprfx, RandGen& rng)
+{
+	// Pairs of sources evicted by another thread may not have been
+	// erased yet
+	std::vector<std::pair<SourceRule, TruthValuePtr>> batch;
+	while (batch.empty() and not _source_rule_set.empty()) {
+		batch = _source_rule_set.select_batch(_config.get_source_rule_selection_mode(),
+		                                      _config.get_batch_size(),
+		                                      _config.get_tournament_size(), rng);
+		boost::remove_erase_if(batch, [&](const auto& sr_tv) {
+				return not _sources.get_source(sr_tv.first.source->id); });
+	}
+	return batch;
 }
 
 TruthValuePtr ForwardChainer::calculate_source_rule_tv(const SourceRule& sr)
@@ -517,22 +852,38 @@ TruthValuePtr ForwardChainer::calculate_source_rule_tv(const SourceRule& sr)
 	return mk_stv(scaled_mean, scaled_variance);
 }
 
+RuleSet ForwardChainer::get_unified_rules(const Source& source,
+                                          const RulePtr& rule,
+                                          unsigned generation)
+{
+	// Unify the source with the rule, unless it has already been
+	// done, in which case the specializations are in the cache of
+	// the source.
+	RuleSet unified_rules;
+	if (not source.get_unified_rules(rule, generation, unified_rules)) {
+		RuleTypedSubstitutionMap urm =
+			rule->unify_source(source.body, source.vardecl, &_kb_as);
+		unified_rules = Rule::strip_typed_substitution(urm);
+		source.set_unified_rules(rule, generation, unified_rules);
+	}
+	return unified_rules;
+}
+
 RuleSet ForwardChainer::get_valid_rules(const Source& source)
 {
-	std::lock_guard<std::mutex> lock(_rules_mutex); // TODO: refine
+	// Read the generation before the rule set, so that if a new rule
+	// set is published in between, the cache gets cleared next time.
+	unsigned generation = _rules_generation;
 
 	// Generate all valid rules
 	RuleSet valid_rules;
-	for (const RulePtr& rule : _rules) {
+	for (const RulePtr& rule : *get_rules()) {
 		// For now ignore meta rules as they are instantiated in
 		// do_step()
 		if (rule->is_meta())
 			continue;
 
-		const AtomSpace& ref_as(_search_focus_set ? _focus_set_as : _kb_as);
-		RuleTypedSubstitutionMap urm =
-			rule->unify_source(source.body, source.vardecl, &ref_as);
-		RuleSet unified_rules = Rule::strip_typed_substitution(urm);
+		RuleSet unified_rules = get_unified_rules(source, rule, generation);
 
 		// Only insert unexhausted rules for this source
 		RuleSet une_rules;
@@ -558,14 +909,16 @@ RuleSet ForwardChainer::get_valid_rules(const Source& source)
 }
 
 RuleProbabilityPair ForwardChainer::select_rule(const Handle& h,
-                                                const std::string& msgprfx)
+                                                const std::string& msgprfx,
+                                                RandGen& rng)
 {
 	Source src(h);
-	return select_rule(src, msgprfx);
+	return select_rule(src, msgprfx, rng);
 }
 
 RuleProbabilityPair ForwardChainer::select_rule(Source& source,
-                                                const std::string& msgprfx)
+                                                const std::string& msgprfx,
+                                                RandGen& rng)
 {
 	const RuleSet valid_rules = get_valid_rules(source);
 
@@ -585,11 +938,12 @@ RuleProbabilityPair ForwardChainer::select_rule(Source& source,
 		return RuleProbabilityPair{nullptr, 0.0};
 	}
 
-	return select_rule(valid_rules, msgprfx);
+	return select_rule(valid_rules, msgprfx, rng);
 };
 
 RuleProbabilityPair ForwardChainer::select_rule(const RuleSet& valid_rules,
-                                                const std::string& msgprfx)
+                                                const std::string& msgprfx,
+                                                RandGen& rng)
 {
 	// Build vector of all valid truth values
 	TruthValueSeq tvs = valid_rules.get_tvs();
@@ -611,7 +965,7 @@ RuleProbabilityPair ForwardChainer::select_rule(const RuleSet& valid_rules,
 
 	// Sample rules according to the weights
 	std::discrete_distribution<size_t> dist(weights.begin(), weights.end());
-	RulePtr selected_rule = rand_element(valid_rules, dist);
+	RulePtr selected_rule = valid_rules[dist(rng)];
 
 	// Calculate the probability estimate of having this rule fulfill
 	// the objective (required to calculate its complexity)
@@ -622,70 +976,411 @@ RuleProbabilityPair ForwardChainer::select_rule(const RuleSet& valid_rules,
 
 HandleSet ForwardChainer::apply_rule(const Rule& rule)
 {
-	HandleSet results;
+	AtomSpace derived_rule_as(&_kb_as);
+	if (_config.get_semi_naive() and is_base_rule(rule))
+		return apply_rule_semi_naive(rule, _kb_as, derived_rule_as);
+	return apply_rule(rule, _kb_as, derived_rule_as);
+}
 
-	// Take the results from applying the rule, add them in the given
-	// AtomSpace and insert them in results
-	auto add_results = [&](AtomSpace& as, const HandleSeq& hs) {
-		for (const Handle& h : hs)
-		{
-			Type t = h->get_type();
-			// If it's a List or Set then add all the results. That
-			// kinda means that to infer List or Set themselves you
-			// need to Quote them.
-			if (t == LIST_LINK or t == SET_LINK)
-				for (const Handle& hc : h->getOutgoingSet())
-					results.insert(as.add_atom(hc));
-			else
-				results.insert(as.add_atom(h));
-		}
-	};
+HandleSet ForwardChainer::apply_rule(const Rule& rule, AtomSpace& ref_as,
+                                     AtomSpace& derived_rule_as)
+{
+	HandleSet results;
 
 	// Wrap in try/catch in case the pattern matcher can't handle it
 	try
 	{
-		AtomSpace& ref_as(_search_focus_set ? _focus_set_as : _kb_as);
-		AtomSpace derived_rule_as(&ref_as);
 		Handle rhcpy = derived_rule_as.add_atom(rule.get_rule());
 
 		// Make Sure that all constant clauses appear in the AtomSpace
 		// as unification might have created constant clauses which aren't
+		// (and in the focus set if any)
 		HandleSeq clauses = rule.get_clauses();
 		const HandleSet& varset = rule.get_variables().varset;
-		for (Handle clause : clauses)
-			if (is_constant(varset, clause))
-				if (ref_as.get_atom(clause) == Handle::UNDEFINED)
+		for (Handle clause : clauses) {
+			if (is_constant(varset, clause)) {
+				Handle ref_clause = ref_as.get_atom(clause);
+				if (ref_clause == Handle::UNDEFINED or
+				    (_search_focus_set and not _focus_set.contains(ref_clause)))
 					return results;
+			}
+		}
 
-		Handle h = HandleCast(rhcpy->execute(&ref_as));
-		add_results(ref_as, h->getOutgoingSet());
+		HandleSeq hs;
+		if (_search_focus_set) {
+			// Only accept groundings within the focus set
+			FocusSetPMCB fs_pmcb(&ref_as, _focus_set);
+			BindLinkPtr bl(BindLinkCast(rhcpy));
+			fs_pmcb.implicand = bl->get_implicand();
+			bl->satisfy(fs_pmcb);
+			for (const ValuePtr& v : fs_pmcb.get_result_set())
+				hs.push_back(HandleCast(v));
+		} else {
+			Handle h = HandleCast(rhcpy->execute(&ref_as));
+			hs = h->getOutgoingSet();
+		}
+		_fcstat.add_pm_execution(hs.size());
+		_budget.add_pm_execution();
+		results = add_products(ref_as, hs);
 	}
 	catch (...) {}
 
 	return results;
 }
 
+HandleSet ForwardChainer::add_products(AtomSpace& as, const HandleSeq& hs)
+{
+	// Take the results from applying the rule, add them in the given
+	// AtomSpace and insert them in results
+	HandleSet results;
+	for (const Handle& h : hs)
+	{
+		Type t = h->get_type();
+		// If it's a List or Set then add all the results. That
+		// kinda means that to infer List or Set themselves you
+		// need to Quote them.
+		if (t == LIST_LINK or t == SET_LINK)
+			for (const Handle& hc : h->getOutgoingSet())
+				results.insert(as.add_atom(hc));
+		else
+			results.insert(as.add_atom(h));
+	}
+
+	_budget.add_produced_atoms(results.size());
+
+	// Products are under focus as well
+	if (_search_focus_set)
+		for (const Handle& h : results)
+			_focus_set.insert(h);
+
+	return results;
+}
+
+void ForwardChainer::start_recording_produced()
+{
+	if (0 <= _produced_connection)
+		return;
+	_produced_connection = _kb_as.atomAddedSignal().connect(
+		[this](const Handle& h) {
+			std::lock_guard<std::mutex> lock(_delta_mutex);
+			_produced.push_back(h);
+		});
+}
+
+void ForwardChainer::stop_recording_produced()
+{
+	if (_produced_connection < 0)
+		return;
+	_kb_as.atomAddedSignal().disconnect(_produced_connection);
+	_produced_connection = -1;
+}
+
+HandleSet ForwardChainer::claim_produced(size_t& begin)
+{
+	HandleSet delta(std::next(_produced.begin(), begin - _produced_begin),
+	                _produced.end());
+	begin = _produced_begin + _produced.size();
+	trim_produced();
+	return delta;
+}
+
+void ForwardChainer::trim_produced()
+{
+	// Drop the deltas of the rules lagging too far behind
+	size_t begin = _produced_begin + _produced.size();
+	if (_max_produced < _produced.size()) {
+		size_t oldest = begin - _max_produced;
+		for (auto it = _delta_begin.begin(); it != _delta_begin.end();) {
+			if (it->second < oldest) {
+				LAZY_URE_LOG_DEBUG << "Drop the delta of rule "
+				                   << it->first->id_to_string()
+				                   << ", its next application will be naive";
+				it = _delta_begin.erase(it);
+			} else {
+				++it;
+			}
+		}
+	}
+
+	// Find the beginning of the oldest unclaimed delta. Rules not
+	// applied yet have no delta, as their first application is
+	// naive, and neither do meta rules if there are none.
+	for (const auto& rule_begin : _delta_begin)
+		begin = std::min(begin, rule_begin.second);
+	if (get_rules()->has_meta_rules())
+		begin = std::min(begin, _meta_rules_delta_begin);
+
+	_produced.erase(_produced.begin(),
+	                std::next(_produced.begin(), begin - _produced_begin));
+	_produced_begin = begin;
+}
+
+HandleSet ForwardChainer::apply_rule_semi_naive(const Rule& rule,
+                                                AtomSpace& ref_as,
+                                                AtomSpace& derived_rule_as)
+{
+	// Claim the delta of that rule. Atoms produced by that
+	// application will be part of its next delta.
+	HandleSet delta;
+	bool first;
+	{
+		std::lock_guard<std::mutex> lock(_delta_mutex);
+		auto it = _delta_begin.find(rule.get_rule());
+		first = it == _delta_begin.end();
+		if (first)
+			_delta_begin[rule.get_rule()] = _produced_begin + _produced.size();
+		else
+			delta = claim_produced(it->second);
+	}
+
+	// Nothing has been applied yet, all atoms are new
+	if (first)
+		return apply_rule(rule, ref_as, derived_rule_as);
+
+	// Only apply the specializations where some premise is in the
+	// delta. Different atoms of the delta may lead to the same
+	// specialization, which is only applied once.
+	RuleSet unified_rules;
+	for (const Handle& d : delta) {
+		RuleTypedSubstitutionMap urm =
+			rule.unify_source(d, Handle::UNDEFINED, &ref_as);
+		RuleSet urs = Rule::strip_typed_substitution(urm);
+		unified_rules.insert(urs.begin(), urs.end());
+	}
+	HandleSet results;
+	for (const RulePtr& ur : unified_rules) {
+		HandleSet products = apply_rule(*ur, ref_as, derived_rule_as);
+		results.insert(products.begin(), products.end());
+	}
+	LAZY_URE_LOG_DEBUG << "Semi-naively applied rule " << rule.get_name()
+	                   << " over a delta of " << delta.size() << " atoms, "
+	                   << unified_rules.size() << " specializations";
+	return results;
+}
+
+bool ForwardChainer::is_base_rule(const Rule& rule) const
+{
+	for (const RulePtr& r : *get_rules())
+		if (r->get_rule() == rule.get_rule())
+			return true;
+	return false;
+}
+
 HandleSet ForwardChainer::apply_rule(const SourceRule& sr)
 {
 	return apply_rule(*sr.rule);
 }
 
+std::vector<HandleSet> ForwardChainer::apply_rules(const std::vector<SourceRule>& srs)
+{
+	return apply_rules(srs, _kb_as);
+}
+
+std::vector<HandleSet> ForwardChainer::apply_rules(const std::vector<SourceRule>& srs,
+                                                   AtomSpace& ref_as)
+{
+	AtomSpace derived_rule_as(&ref_as);
+
+	// Group the pairs by base rule and by premise their source is
+	// bound to. Base rules are added to derived_rule_as, so that the
+	// premises of the base rules handed over to the pattern matcher
+	// are the ones it is going to report.
+	std::shared_ptr<const RuleSet> rules = get_rules();
+	std::map<Handle, Rule> base_rules;
+	std::map<std::pair<Handle, size_t>, std::vector<size_t>> groups;
+	if (1 < srs.size()) {
+		for (size_t i = 0; i < srs.size(); i++) {
+			const Handle& alias = srs[i].rule->get_alias();
+			if (not alias or is_base_rule(*srs[i].rule))
+				continue;
+			// Mesa rules share the alias of their meta rule, thus all
+			// rules of that alias are candidate base rules.
+			for (const RulePtr& rule : *rules) {
+				if (rule->is_meta() or rule->get_alias() != alias)
+					continue;
+				auto it = base_rules.find(rule->get_rule());
+				if (it == base_rules.end()) {
+					Rule base_rule(*rule);
+					base_rule.set_rule(derived_rule_as.add_atom(rule->get_rule()));
+					it = base_rules.insert({rule->get_rule(), base_rule}).first;
+				}
+				int premise = get_source_premise(srs[i], it->second);
+				if (0 <= premise) {
+					groups[{it->first, premise}].push_back(i);
+					break;
+				}
+			}
+		}
+	}
+
+	// Apply the groups of more than one pair with a single query of
+	// their base rule. Single pairs are better off with their
+	// specialization, whose constant premise is a cheaper starting
+	// point for the pattern matcher.
+	std::vector<HandleSet> results(srs.size());
+	std::vector<bool> applied(srs.size(), false);
+	for (const auto& group : groups) {
+		const std::vector<size_t>& indices = group.second;
+		if (indices.size() < 2)
+			continue;
+		std::vector<SourceRule> group_srs;
+		for (size_t i : indices)
+			group_srs.push_back(srs[i]);
+		std::vector<HandleSet> group_results =
+			apply_rule_batch(base_rules.at(group.first.first),
+			                 group.first.second, group_srs, ref_as);
+		for (size_t k = 0; k < indices.size(); k++) {
+			results[indices[k]] = group_results[k];
+			applied[indices[k]] = true;
+		}
+		LAZY_URE_LOG_DEBUG << "Applied " << indices.size() << " source rule pairs "
+		                   << "with a single query of their base rule";
+	}
+
+	// Apply the remaining pairs one by one
+	for (size_t i = 0; i < srs.size(); i++) {
+		if (applied[i])
+			continue;
+
+		// Reuse the products of an alpha-equivalent rule if already
+		// applied in that batch
+		size_t j = 0;
+		while (j < i and (applied[j] or not (*srs[j].rule == *srs[i].rule)))
+			j++;
+		if (j < i)
+			results[i] = results[j];
+		else if (_config.get_semi_naive() and is_base_rule(*srs[i].rule))
+			results[i] = apply_rule_semi_naive(*srs[i].rule, ref_as,
+			                                   derived_rule_as);
+		else
+			results[i] = apply_rule(*srs[i].rule, ref_as, derived_rule_as);
+	}
+	return results;
+}
+
+std::vector<HandleSet> ForwardChainer::apply_rule_batch(const Rule& rule,
+                                                        size_t premise,
+                                                        const std::vector<SourceRule>& srs,
+                                                        AtomSpace& ref_as)
+{
+	std::vector<HandleSet> results(srs.size());
+
+	// Index the pairs by the bodies of their sources, as found in the
+	// knowledge base (and in the focus set if any)
+	HandleSet bodies;
+	std::map<Handle, std::vector<size_t>> indices;
+	for (size_t i = 0; i < srs.size(); i++) {
+		Handle body = ref_as.get_atom(srs[i].source->body);
+		if (not body or (_search_focus_set and not _focus_set.contains(body)))
+			continue;
+		bodies.insert(body);
+		indices[body].push_back(i);
+	}
+	if (bodies.empty())
+		return results;
+
+	// Wrap in try/catch in case the pattern matcher can't handle it
+	try
+	{
+		BatchPMCB batch_pmcb(&ref_as, rule.get_premises()[premise], bodies,
+		                     _search_focus_set ? &_focus_set : nullptr);
+		BindLinkPtr bl(BindLinkCast(rule.get_rule()));
+		batch_pmcb.implicand = bl->get_implicand();
+		bl->satisfy(batch_pmcb);
+
+		// Dispatch the products to the pairs of their source
+		size_t matches = 0;
+		for (const auto& body_products : batch_pmcb.get_products()) {
+			matches += body_products.second.size();
+			HandleSet products = add_products(ref_as, body_products.second);
+			for (size_t i : indices[body_products.first])
+				results[i] = products;
+		}
+		_fcstat.add_pm_execution(matches);
+		_budget.add_pm_execution();
+	}
+	catch (...) {}
+
+	return results;
+}
+
+int ForwardChainer::get_source_premise(const SourceRule& sr,
+                                       const Rule& rule) const
+{
+	// Only closed sources are considered, as binding a premise to
+	// such a source amounts to restricting its groundings to the
+	// source itself.
+	const Handle& body = sr.source->body;
+	if (not get_free_variables(body).empty())
+		return -1;
+
+	// Find the premise such that substituting it by the source
+	// yields the specialization of the pair
+	HandleSeq premises = rule.get_premises();
+	Handle vardecl = rule.get_vardecl();
+	for (size_t i = 0; i < premises.size(); i++) {
+		Unify unify(body, premises[i], Handle::UNDEFINED, vardecl);
+		Unify::SolutionSet sol = unify();
+		if (not sol.is_satisfiable())
+			continue;
+		for (const auto& ts : unify.typed_substitutions(sol, body))
+			if (rule.substituted(ts, &_kb_as) == *sr.rule)
+				return i;
+	}
+	return -1;
+}
+
 void ForwardChainer::validate(const Handle& source)
 {
 	if (source == Handle::UNDEFINED)
 		throw RuntimeException(TRACE_INFO, "ForwardChainer - Invalid source.");
 }
 
+std::shared_ptr<const RuleSet> ForwardChainer::get_rules() const
+{
+	return std::atomic_load(&_rules);
+}
+
 void ForwardChainer::expand_meta_rules(const std::string& msgprfx)
 {
-	std::lock_guard<std::mutex> lock(_rules_mutex);
+	// Only one thread expands meta rules at a time, the others carry
+	// on with the current rule set.
+	std::unique_lock<std::mutex> lock(_rules_mutex, std::try_to_lock);
+	if (not lock.owns_lock())
+		return;
+
 	// This is kinda of hack before meta rules are fully supported by
 	// the Rule class.
-	size_t rules_size = _rules.size();
-	_rules.expand_meta_rules(_kb_as);
+	std::shared_ptr<const RuleSet> rules = get_rules();
+	if (not rules->has_meta_rules())
+		return;
+
+	// Claim the atoms produced since the last expansion
+	HandleSet new_atoms;
+	bool first = not _meta_rules_expanded;
+	{
+		std::lock_guard<std::mutex> delta_lock(_delta_mutex);
+		new_atoms = claim_produced(_meta_rules_delta_begin);
+	}
+	_meta_rules_expanded = true;
+
+	// The first expansion goes over the whole knowledge base, the
+	// subsequent ones only over the new atoms.
+	if (not first and new_atoms.empty())
+		return;
+	auto expanded_rules = std::make_shared<RuleSet>(*rules);
+	if (first)
+		expanded_rules->expand_meta_rules(_kb_as);
+	else
+		expanded_rules->expand_meta_rules(_kb_as, new_atoms);
 
-	if (rules_size != _rules.size()) {
+	if (rules->size() != expanded_rules->size()) {
 		ure_logger().debug() << msgprfx << "The rule set has gone from "
-		                     << rules_size << " to " << _rules.size() << " rules";
+		                     << rules->size() << " to " << expanded_rules->size()
+		                     << " rules";
+		// Publish the new rule set. Readers holding the previous one
+		// keep it alive till they are done.
+		std::atomic_store(&_rules, std::shared_ptr<const RuleSet>(expanded_rules));
+		_rules_generation++;
 	}
 }
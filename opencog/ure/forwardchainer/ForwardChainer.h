@@ -24,24 +24,27 @@
 #ifndef _OPENCOG_FORWARDCHAINER_H_
 #define _OPENCOG_FORWARDCHAINER_H_
 
+#include <deque>
+#include <functional>
+#include <map>
+#include <memory>
 #include <mutex>
-// #include <shared_mutex>
 
 #include "../UREConfig.h"
+#include "../ThreadPool.h"
+#include "../Budget.h"
+#include "../URERandom.h"
 #include "SourceSet.h"
 #include "SourceRuleSet.h"
 #include "FCStat.h"
+#include "AlphaNetwork.h"
+#include "FocusSet.h"
 
 class ForwardChainerUTest;
 
 namespace opencog
 {
 
-enum class source_selection_mode
-{
-	TV_FITNESS, STI, UNIFORM
-};
-
 class Rule;
 
 // Pair of Rule and its probability estimate that it fullfils the
@@ -97,14 +100,35 @@ public:
 	/**
 	 * run steps (single or multi threaded) until termination criteria
 	 * are met.
+	 *
+	 * The multi threaded version runs as many steppers as jobs on the
+	 * chainer's thread pool, each stepper claiming and running
+	 * iterations till termination.
 	 */
 	void do_steps_singlethread();
 	void do_steps_multithread();
 
 	/**
-	 * Source rule producer implementation of do_steps.
+	 * Source rule producer implementation of do_steps (single or
+	 * multi threaded).
+	 *
+	 * The multi threaded version proceeds in rounds of as many
+	 * iterations as jobs. The source rule pairs of the iterations of
+	 * a round are selected on the calling thread, in iteration order,
+	 * then applied in parallel, each iteration against its own child
+	 * atomspace of the knowledge base, then their products are merged
+	 * in iteration order. Thus, like the single threaded version, it
+	 * is deterministic for a given random seed and number of jobs.
+	 *
+	 * In both versions, an iteration whose selection fails, for
+	 * instance because all pairs have been tried, still counts
+	 * towards the maximum number of iterations, so that the
+	 * iteration numbers, thus the random substreams, do not depend
+	 * on the outcome of previous selections. Such an iteration
+	 * produces no inference record.
 	 */
 	void do_steps_srpi();
+	void do_steps_srpi_multithread();
 
 	/**
 	 * Perform a single forward chaining inference step on the given
@@ -117,6 +141,25 @@ public:
 	 */
 	void do_step_srpi(int iteration);
 
+	typedef std::vector<std::pair<SourceRule, TruthValuePtr>> SourceRuleBatch;
+
+	/**
+	 * Selection phase of do_step_srpi. Expand the meta rules,
+	 * populate the source rule set, and select a batch of source rule
+	 * pairs for the given iteration. Return an empty batch if the
+	 * selection has failed.
+	 */
+	SourceRuleBatch select_step_srpi(int iteration, const std::string& msgprfx);
+
+	/**
+	 * Merge phase of do_step_srpi. Insert the products of each pair
+	 * of the batch, in the same order, in the source set, and record
+	 * the inferences.
+	 */
+	void merge_step_srpi(int iteration, const std::string& msgprfx,
+	                     const SourceRuleBatch& slc_batch,
+	                     const std::vector<HandleSet>& products);
+
 	/**
 	 * @return true if the termination criteria have been met.
 	 */
@@ -133,6 +176,51 @@ public:
 	Handle get_results() const;
 	HandleSet get_results_set() const;
 
+	/**
+	 * @return the statistics of the inferences, including the
+	 *         inference records and the pattern matcher usage.
+	 */
+	const FCStat& get_fcstat() const;
+
+	/**
+	 * @return the number of iterations claimed so far.
+	 */
+	int get_iteration() const;
+
+	/**
+	 * @return the population of sources.
+	 */
+	const SourceSet& get_source_set() const;
+
+	/**
+	 * Callback receiving a product, alongside the source and the rule
+	 * that have produced it, as soon as it is produced.
+	 */
+	typedef std::function<void(const Handle& product,
+	                           const Handle& source,
+	                           const Rule& rule)> ProductCallback;
+
+	/**
+	 * Register a callback to be called on each product during
+	 * chaining, and return its subscription id. If pattern is
+	 * defined, only products unifying with it (its variables being
+	 * declared by vardecl) are passed to the callback.
+	 *
+	 * When multi-threaded, callbacks are called from the threads
+	 * producing the products, possibly concurrently, thus must be
+	 * thread safe. Products are passed every time they are produced,
+	 * thus possibly more than once.
+	 */
+	size_t subscribe(const ProductCallback& callback,
+	                 const Handle& pattern=Handle::UNDEFINED,
+	                 const Handle& vardecl=Handle::UNDEFINED);
+
+	/**
+	 * Remove the subscription of the given id. Return false if there
+	 * was none.
+	 */
+	bool unsubscribe(size_t id);
+
 private:
 	friend class ::ForwardChainerUTest;
 
@@ -140,10 +228,42 @@ private:
 	          const Handle& vardecl,
 	          const HandleSeq& focus_set);
 
+	/**
+	 * Return the thread pool, (re)creating it if its number of
+	 * workers does not match the number of jobs.
+	 */
+	ThreadPool& get_thread_pool();
+
+	/**
+	 * Run as many steppers as jobs on the thread pool. Each stepper
+	 * claims iterations and call step on them till termination.
+	 */
+	void run_steppers(const std::function<void(int)>& step);
+
+	/**
+	 * Atomically claim the next iteration. Return -1 if the maximum
+	 * number of iterations has been reached.
+	 */
+	int claim_iteration();
+
 	void apply_all_rules();
 
+	/**
+	 * Pass products of the given source and rule to the subscribed
+	 * callbacks.
+	 */
+	void notify_products(const Handle& source, const Rule& rule,
+	                     const HandleSet& products);
+
 	void validate(const Handle& source);
 
+	/**
+	 * Return the current rule set. The rule set is immutable, meta
+	 * rule expansion publishes a new one instead of modifying it, so
+	 * that it can be read without locking.
+	 */
+	std::shared_ptr<const RuleSet> get_rules() const;
+
 	/**
 	 * Expand all meta rules into mesa rules.
 	 *
@@ -159,30 +279,69 @@ private:
 	 * Warning: it is not const because the source is gonna be modified
 	 * by keeping track of the rules applied to it.
 	 */
-	SourcePtr select_source(const std::string& msgprfx);
+	SourcePtr select_source(const std::string& msgprfx, RandGen& rng);
 
 	/**
 	 * Build a source rule pair for application trial. If and only if
 	 * no such pair is available, then return an invalid pair.
 	 */
-	SourceRule mk_source_rule(const std::string& msgprfx);
+	SourceRule mk_source_rule(const std::string& msgprfx, RandGen& rng);
+
+	/**
+	 * Pop candidates from the alpha network till one has an untried
+	 * rule specialization, resolved through the unification cache of
+	 * its source, and return the pair of that source and
+	 * specialization, marked as tried. Candidates of evicted sources
+	 * are skipped. If no such pair is available, then return an
+	 * invalid pair.
+	 */
+	SourceRule pop_activation(const std::string& msgprfx);
+
+	/**
+	 * Recompile the alpha network if the rule set has changed, then
+	 * push all sources through it again.
+	 */
+	void update_alpha_network();
+
+	/**
+	 * Discard the pairs of the given evicted sources from the source
+	 * rule set and the alpha network.
+	 */
+	void erase_sources(const std::vector<size_t>& source_ids);
 
 	/**
 	 * Populate the source rule set with pairs
 	 */
-	void populate_source_rule_set(const std::string& msgprfx);
+	void populate_source_rule_set(const std::string& msgprfx, RandGen& rng);
 
 	/**
-	 * Select source rule pair
+	 * Select source rule pair, skipping the pairs of evicted sources
 	 */
 	std::pair<SourceRule, TruthValuePtr>
-	select_source_rule(const std::string& msgprfx);
+	select_source_rule(const std::string& msgprfx, RandGen& rng);
+
+	/**
+	 * Select a batch of source rule pairs sharing the same base rule,
+	 * of at most the batch size parameter. The first pair is selected
+	 * as in select_source_rule. Pairs of evicted sources are
+	 * discarded. Return an empty batch on failure.
+	 */
+	std::vector<std::pair<SourceRule, TruthValuePtr>>
+	select_source_rules(const std::string& msgprfx, RandGen& rng);
 
 	/**
 	 * Given a source rule pair, calculate its truth value of success.
 	 */
 	TruthValuePtr calculate_source_rule_tv(const SourceRule& sr);
 
+	/**
+	 * Return the specializations of rule unifying with the source,
+	 * taken from the cache of the source if it is valid for that
+	 * generation, otherwise computed and cached.
+	 */
+	RuleSet get_unified_rules(const Source& source, const RulePtr& rule,
+	                          unsigned generation);
+
 	/**
 	 * Get rules that unify with the source and that are not exhausted,
 	 * which include rules currently being run.
@@ -200,11 +359,14 @@ private:
 	 * TODO: move to ControlPolicy
 	 */
 	RuleProbabilityPair select_rule(const Handle& source,
-	                                const std::string& msgprfx="");
+	                                const std::string& msgprfx="",
+	                                RandGen& rng=randGen());
 	RuleProbabilityPair select_rule(Source& source,
-	                                const std::string& msgprfx="");
+	                                const std::string& msgprfx="",
+	                                RandGen& rng=randGen());
 	RuleProbabilityPair select_rule(const RuleSet&,
-	                                const std::string& msgprfx="");
+	                                const std::string& msgprfx="",
+	                                RandGen& rng=randGen());
 
 	/**
 	 * Apply rule.
@@ -212,7 +374,104 @@ private:
 	HandleSet apply_rule(const Rule& rule);
 	HandleSet apply_rule(const SourceRule& sr);
 
-	RuleSet _rules; /* loaded rules */
+	/**
+	 * Apply a batch of source rule pairs, and return the products of
+	 * each pair, in the same order.
+	 *
+	 * Pairs whose sources are bound to the same premise of the same
+	 * base rule are applied with a single query of that base rule,
+	 * see apply_rule_batch. The other pairs are applied one by one,
+	 * all rules being added to the same derived atomspace, and
+	 * alpha-equivalent rules, as obtained when different sources
+	 * lead to the same specialization, are only executed once. Base
+	 * rules, as obtained with full rule application, are applied
+	 * semi-naively if enabled.
+	 *
+	 * The rules are applied against ref_as, the knowledge base or a
+	 * child atomspace of it, which receives the products.
+	 */
+	std::vector<HandleSet> apply_rules(const std::vector<SourceRule>& srs);
+	std::vector<HandleSet> apply_rules(const std::vector<SourceRule>& srs,
+	                                   AtomSpace& ref_as);
+
+	/**
+	 * Apply rule, whose given premise is bound to the sources of the
+	 * source rule pairs, with a single pattern matcher query, the
+	 * groundings of that premise being restricted to the source
+	 * bodies. Return the products of each pair, in the same order.
+	 */
+	std::vector<HandleSet> apply_rule_batch(const Rule& rule, size_t premise,
+	                                        const std::vector<SourceRule>& srs,
+	                                        AtomSpace& ref_as);
+
+	/**
+	 * Return the index of the premise of rule that the source of sr
+	 * is bound to in order to obtain the rule of sr, or -1 if sr is
+	 * not a specialization of rule or if its source is not closed.
+	 */
+	int get_source_premise(const SourceRule& sr, const Rule& rule) const;
+
+	/**
+	 * Apply rule, added to derived_rule_as, over ref_as.
+	 */
+	HandleSet apply_rule(const Rule& rule, AtomSpace& ref_as,
+	                     AtomSpace& derived_rule_as);
+
+	/**
+	 * Add the results of a rule application to as, flattening List
+	 * and Set links, and return them. Also account for them in the
+	 * budget and the focus set.
+	 */
+	HandleSet add_products(AtomSpace& as, const HandleSeq& hs);
+
+	/**
+	 * Start and stop recording in _produced the atoms added to the
+	 * knowledge base, whether they are products, their outgoing
+	 * atoms, or atoms added from outside the chainer.
+	 */
+	void start_recording_produced();
+	void stop_recording_produced();
+
+	/**
+	 * Return the atoms recorded since begin, an index in _produced
+	 * counted from the first atom ever recorded, and move begin past
+	 * them. _delta_mutex must be held.
+	 */
+	HandleSet claim_produced(size_t& begin);
+
+	/**
+	 * Discard the recorded atoms that have been claimed by all
+	 * deltas. Deltas lagging more than _max_produced atoms behind are
+	 * dropped beforehand, so that the next application of their rules
+	 * is naive again. _delta_mutex must be held.
+	 */
+	void trim_produced();
+
+	/**
+	 * Semi-naive application of a rule. The first application is
+	 * naive, subsequent ones only apply the specializations of the
+	 * rule obtained by unifying its premises with atoms produced
+	 * since its previous application (the delta), so that groundings
+	 * involving old atoms only are not enumerated again. The
+	 * specializations are deduplicated across the delta before being
+	 * applied.
+	 */
+	HandleSet apply_rule_semi_naive(const Rule& rule, AtomSpace& ref_as,
+	                                AtomSpace& derived_rule_as);
+
+	/**
+	 * Return true iff the rule is one of the rule set, as opposed to
+	 * a specialization of it.
+	 */
+	bool is_base_rule(const Rule& rule) const;
+
+	// Loaded rules. Only accessed via std::atomic_load and
+	// std::atomic_store, see get_rules() and expand_meta_rules().
+	std::shared_ptr<const RuleSet> _rules;
+
+	// Incremented each time a new rule set is published, to
+	// invalidate the caches of unified rules of the sources.
+	std::atomic<unsigned> _rules_generation;
 
 	// Knowledge base atomspace
 	AtomSpace& _kb_as;
@@ -220,35 +479,65 @@ private:
 	// Rule base atomspace (can be the same as _kb_as)
 	AtomSpace& _rb_as;
 
-	// The focus set is copied into this atomspace; during chaining,
-	// the pattern matcher is applied only to this atomspace.  This
-	// is the primary mechanism by which chaining is restricted to
-	// the focus set.  This is effective, but not very efficient;
-	// perhaps there is some better mechanism?
-	AtomSpace _focus_set_as;
+	// Membership index of the focus set over _kb_as. During
+	// chaining, the pattern matcher only accepts clause groundings
+	// in that index, and products are inserted in it.
+	FocusSet _focus_set;
 
 	UREConfig _config;
 
+	// Resource budget, see UREConfig
+	Budget _budget;
+
+	// Seed of the random draws of the current chaining. Each
+	// iteration draws from its own substream, see ure_substream.
+	unsigned long _seed;
+
 	// Current iteration
 	std::atomic<int> _iteration;
 
 	bool _search_focus_set;
 
-	// TODO: subdivide in smaller and shared mutexes
-	mutable std::mutex _whole_mutex;
-	mutable std::mutex _part_mutex;
-
-	// TODO: use shared mutexes
+	// Serialize meta rule expansions. Readers of _rules do not take
+	// it.
 	mutable std::mutex _rules_mutex;
 
-	// Keep track of the number of threads to make sure
-	std::atomic<int> _thread_count;
+	// Pool of workers running the steps when multi-threaded. It is
+	// created on first use so that single-threaded chaining does not
+	// spawn any thread.
+	std::unique_ptr<ThreadPool> _thread_pool;
 
 	// Population of sources to expand forward
 	SourceSet _sources;
 
 	FCStat _fcstat;
 
+	// Id of the connection recording the atoms added to the
+	// knowledge base, -1 if none. They are only recorded if there are
+	// meta rules or if semi-naive evaluation is enabled.
+	int _produced_connection;
+
+	// Atoms added to the knowledge base and not yet claimed by all
+	// deltas, in order of addition, and the index of the first one
+	// counted from the first atom ever recorded. For each base rule
+	// applied semi-naively, the index of the beginning of its
+	// delta. Guarded by _delta_mutex.
+	std::deque<Handle> _produced;
+	size_t _produced_begin;
+	std::map<Handle, size_t> _delta_begin;
+
+	// Maximum number of recorded atoms a rule delta may lag behind,
+	// so that a rule not applied for long does not pin _produced.
+	size_t _max_produced;
+	std::mutex _delta_mutex;
+
+	// Whether meta rules have been expanded over the whole knowledge
+	// base, guarded by _rules_mutex, and the index of the beginning
+	// of the atoms they have not been expanded over yet, guarded by
+	// _delta_mutex.
+	bool _meta_rules_expanded;
+	size_t _meta_rules_delta_begin;
+
 	// Enable alternative implementation using (source, rule) producer,
 	// srpi stands for Source Rule Producer Implementation. This flag
 	// is here, likely temporarily, to compare old and new way.
@@ -256,6 +545,23 @@ private:
 
 	// Set of weighted pairs (source, rule).
 	SourceRuleSet _source_rule_set;
+
+	// Alpha network producing candidate source rule pairs as sources
+	// are produced. Null unless the match network parameter is set.
+	std::unique_ptr<AlphaNetwork> _alpha_network;
+
+	struct Subscription
+	{
+		ProductCallback callback;
+		Handle pattern;
+		Handle vardecl;
+	};
+
+	// Subscriptions to products, indexed by id. Guarded by
+	// _subscriptions_mutex.
+	std::map<size_t, Subscription> _subscriptions;
+	size_t _next_subscription_id;
+	std::mutex _subscriptions_mutex;
 };
 
 } // ~namespace opencog
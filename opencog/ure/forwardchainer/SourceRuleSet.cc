@@ -22,8 +22,9 @@
 
 #include "SourceRuleSet.h"
 
-#include <boost/range/algorithm/lower_bound.hpp>
-#include <boost/algorithm/cxx11/all_of.hpp>
+#include <random>
+
+#include <boost/math/special_functions/beta.hpp>
 
 #include <opencog/util/oc_assert.h>
 
@@ -40,13 +41,13 @@ SourceRule::~SourceRule()
 
 bool SourceRule::operator==(const SourceRule& other) const
 {
-	return &source == &other.source and &rule == &other.rule;
+	return source.get() == other.source.get() and rule.get() == other.rule.get();
 }
 
 bool SourceRule::operator<(const SourceRule& other) const
 {
-	return (&source < &other.source)
-		or (&source == &other.source and &rule < &other.rule);
+	return (source.get() < other.source.get())
+		or (source.get() == other.source.get() and rule.get() < other.rule.get());
 }
 
 bool SourceRule::is_valid() const
@@ -66,61 +67,221 @@ std::string SourceRule::to_string(const std::string& indent) const
 	return ss.str();
 }
 
+const double SourceRuleSet::tail_probability = 1e-3;
+
 SourceRuleSet::SourceRuleSet()
-	: _thompson_smp(tv_seq)
 {
 }
 
 bool SourceRuleSet::insert(const SourceRule& sr, TruthValuePtr tv)
 {
-	auto it = boost::lower_bound(source_rule_seq, sr);
-	if (it == source_rule_seq.end() or *it != sr) {
-		it = source_rule_seq.insert(it, sr);
-		size_t idx = std::distance(source_rule_seq.begin(), it);
-		tv_seq.insert(std::next(tv_seq.begin(), idx), tv);
-		return true;
+	std::lock_guard<std::mutex> lock(_mutex);
+
+	// Reserve a slot, unless the pair is already in the source rule
+	// set.
+	size_t slot = _free_slots.empty() ? _source_rules.size() : _free_slots.back();
+	if (not _slot_index.insert({sr, slot}).second)
+		return false;
+
+	BetaDistribution bd(tv);
+	double alpha = bd.alpha(), beta = bd.beta(), mean = bd.mean();
+	double bound = boost::math::ibeta_inv(alpha, beta, 1.0 - tail_probability);
+
+	if (_free_slots.empty()) {
+		_source_rules.push_back(sr);
+		_tvs.push_back(tv);
+		_alphas.push_back(alpha);
+		_betas.push_back(beta);
+		_bounds.push_back(bound);
+		_means.push_back(mean);
+		_occupied.push_back(1.0);
+	} else {
+		_free_slots.pop_back();
+		_source_rules[slot] = sr;
+		_tvs[slot] = tv;
+		_alphas[slot] = alpha;
+		_betas[slot] = beta;
+		_bounds[slot] = bound;
+		_means.set(slot, mean);
+		_occupied.set(slot, 1.0);
 	}
-	// The pair is already in the source rule set
-	return false;
+	_slots_by_bound.insert({bound, slot});
+	if (sr.rule->get_alias())
+		_slots_by_rule[sr.rule->get_alias()].insert(slot);
+	_slots_by_source[sr.source->id].insert(slot);
+	return true;
 }
 
-std::pair<SourceRule, TruthValuePtr> SourceRuleSet::thompson_select()
+std::pair<SourceRule, TruthValuePtr> SourceRuleSet::thompson_select(RandGen& rng)
 {
-	if (tv_seq.empty())
+	return select(source_rule_selection_mode::THOMPSON, 2, rng);
+}
+
+std::pair<SourceRule, TruthValuePtr>
+SourceRuleSet::select(source_rule_selection_mode mode, int tournament_size,
+                      RandGen& rng)
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+	if (_slot_index.empty())
 		return {SourceRule(), nullptr};
 
-	// Select the next source rule pair to apply
-	size_t rnd_idx = _thompson_smp();
-	SourceRule slc_sr = source_rule_seq[rnd_idx];
-	TruthValuePtr slc_tv = tv_seq[rnd_idx];
+	// Select the next source rule pair to apply, and remove it from
+	// the container to not be selected again
+	return take(select_slot(mode, tournament_size, rng));
+}
+
+std::vector<std::pair<SourceRule, TruthValuePtr>>
+SourceRuleSet::select_batch(source_rule_selection_mode mode, int batch_size,
+                            int tournament_size, RandGen& rng)
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+	std::vector<std::pair<SourceRule, TruthValuePtr>> batch;
+	if (_slot_index.empty())
+		return batch;
+
+	// Select the anchor of the batch
+	batch.push_back(take(select_slot(mode, tournament_size, rng)));
+	const Handle& alias = batch.front().first.rule->get_alias();
+	if (batch_size <= 1 or not alias)
+		return batch;
+
+	auto it = _slots_by_rule.find(alias);
+	if (it == _slots_by_rule.end())
+		return batch;
+
+	// Gather the other pairs of the same base rule by decreasing
+	// bound. The slots are copied as take modifies the index.
+	std::set<std::pair<double, size_t>, std::greater<std::pair<double, size_t>>> candidates;
+	for (size_t slot : it->second)
+		candidates.insert({_bounds[slot], slot});
+	for (const auto& bs : candidates) {
+		if ((int)batch.size() == batch_size)
+			break;
+		batch.push_back(take(bs.second));
+	}
+	return batch;
+}
+
+size_t SourceRuleSet::select_slot(source_rule_selection_mode mode,
+                                  int tournament_size, RandGen& rng) const
+{
+	switch (mode) {
+	case source_rule_selection_mode::TV_FITNESS:
+		// Sampling a null sum tree is undefined
+		if (_means.total() <= 0.0)
+			return _occupied(rng);
+		return _means(rng);
+	case source_rule_selection_mode::TOURNAMENT: {
+		size_t best = _occupied(rng);
+		for (int k = 1; k < tournament_size; k++) {
+			size_t slot = _occupied(rng);
+			if (_means.get(best) < _means.get(slot))
+				best = slot;
+		}
+		return best;
+	}
+	case source_rule_selection_mode::UNIFORM:
+		return _occupied(rng);
+	default:
+		return thompson_select_slot(rng);
+	}
+}
 
-	// Remove it from the container to not be selected again
-	source_rule_seq.erase(std::next(source_rule_seq.begin(), rnd_idx));
-	tv_seq.erase(std::next(tv_seq.begin(), rnd_idx));
+size_t SourceRuleSet::thompson_select_slot(RandGen& rng) const
+{
+	// Visit pairs by decreasing bound till no remaining pair can beat
+	// the best sample. Beta samples are obtained from gamma samples,
+	// X/(X+Y) with X~Gamma(alpha) and Y~Gamma(beta), which is much
+	// cheaper than inverting the incomplete beta function.
+	double best = -1.0;
+	size_t slc_slot = 0;
+	for (const auto& bs : _slots_by_bound) {
+		if (bs.first <= best)
+			break;
+		size_t slot = bs.second;
+		double x = std::gamma_distribution<double>(_alphas[slot])(rng),
+			y = std::gamma_distribution<double>(_betas[slot])(rng),
+			smp = x / (x + y);
+		if (best < smp) {
+			best = smp;
+			slc_slot = slot;
+		}
+	}
+	return slc_slot;
+}
 
-	// Return the selected source rule pair
-	return {slc_sr, slc_tv};
+void SourceRuleSet::erase(size_t slot)
+{
+	_slots_by_bound.erase({_bounds[slot], slot});
+	_slot_index.erase(_source_rules[slot]);
+	const Handle& alias = _source_rules[slot].rule->get_alias();
+	if (alias) {
+		auto it = _slots_by_rule.find(alias);
+		it->second.erase(slot);
+		if (it->second.empty())
+			_slots_by_rule.erase(it);
+	}
+	auto it = _slots_by_source.find(_source_rules[slot].source->id);
+	it->second.erase(slot);
+	if (it->second.empty())
+		_slots_by_source.erase(it);
+
+	// Release the pointers so that the source and rule are not kept
+	// alive by a free slot
+	_source_rules[slot] = SourceRule();
+	_tvs[slot] = nullptr;
+	_means.set(slot, 0.0);
+	_occupied.set(slot, 0.0);
+	_free_slots.push_back(slot);
+}
+
+std::pair<SourceRule, TruthValuePtr> SourceRuleSet::take(size_t slot)
+{
+	std::pair<SourceRule, TruthValuePtr> sr_tv{_source_rules[slot], _tvs[slot]};
+	erase(slot);
+	return sr_tv;
+}
+
+void SourceRuleSet::erase_sources(const std::vector<size_t>& source_ids)
+{
+	std::lock_guard<std::mutex> lock(_mutex);
+	for (size_t id : source_ids) {
+		auto it = _slots_by_source.find(id);
+		if (it == _slots_by_source.end())
+			continue;
+		// Copy the slots as erase modifies the index
+		std::set<size_t> slots(it->second);
+		for (size_t slot : slots)
+			erase(slot);
+	}
 }
 
 bool SourceRuleSet::empty() const
 {
-	return source_rule_seq.empty();
+	std::lock_guard<std::mutex> lock(_mutex);
+	return _slot_index.empty();
 }
 
 size_t SourceRuleSet::size() const
 {
-	return source_rule_seq.size();
+	std::lock_guard<std::mutex> lock(_mutex);
+	return _slot_index.size();
 }
 
 std::string SourceRuleSet::to_string(const std::string& indent) const
 {
+	std::lock_guard<std::mutex> lock(_mutex);
 	std::stringstream ss;
 	std::string indent2 = indent + oc_to_string_indent;
-	ss << indent << "size = " << source_rule_seq.size();
+	ss << indent << "size = " << _slot_index.size();
+	// Display by decreasing bound
 	size_t i = 0;
-	for (const SourceRule& sr : source_rule_seq) {
+	for (const auto& bs : _slots_by_bound) {
+		size_t slot = bs.second;
 		ss << std::endl << indent << "(source,rule)[" << i << "]:"
-		   << std::endl << sr.to_string(indent2);
+		   << std::endl << _source_rules[slot].to_string(indent2)
+		   << std::endl << indent2 << "alpha = " << _alphas[slot]
+		   << ", beta = " << _betas[slot] << ", bound = " << bs.first;
 		i++;
 	}
 	return ss.str();
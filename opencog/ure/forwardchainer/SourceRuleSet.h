@@ -24,12 +24,21 @@
 #ifndef _OPENCOG_SOURCERULESET_H_
 #define _OPENCOG_SOURCERULESET_H_
 
+#include <map>
+#include <mutex>
+#include <set>
+#include <vector>
+
 #include <opencog/util/empty_string.h>
 
-#include "../ThompsonSampling.h"
+#include "../BetaDistribution.h"
+#include "../SumTree.h"
+#include "../UREConfig.h"
 
 #include "SourceSet.h"
 
+class SourceRuleSetUTest;
+
 namespace opencog
 {
 
@@ -89,6 +98,8 @@ public:
 	 * Insert (source, rule) pair in the container, alongside it's
 	 * second order probability of success. Return false if insertion
 	 * fails, that is such pair already exists in the container.
+	 *
+	 * O(log n).
 	 */
 	bool insert(const SourceRule& sr, TruthValuePtr tv);
 
@@ -96,11 +107,46 @@ public:
 	 * Select a pair according to Thompson sampling and remove it from
 	 * the set. Return the empty source rule pair, and the nullptr
 	 * truth value if the set is empty.
+	 *
+	 * Sampling is lazy. Pairs are visited by decreasing upper bound
+	 * (see _bounds), and the visit stops as soon as the best sample
+	 * so far is greater than the upper bound of the next pair. Thus
+	 * only the pairs with a fair chance of winning get sampled.
+	 */
+	std::pair<SourceRule, TruthValuePtr> thompson_select(RandGen& rng=randGen());
+
+	/**
+	 * Like thompson_select but according to the given selection
+	 * mode. Fitness proportionate and uniform selections are O(log
+	 * n), tournament selection of size k is O(k log n). Fitness
+	 * proportionate selection falls back to uniform selection if all
+	 * means are null.
+	 */
+	std::pair<SourceRule, TruthValuePtr> select(source_rule_selection_mode mode,
+	                                            int tournament_size=2,
+	                                            RandGen& rng=randGen());
+
+	/**
+	 * Like select, but also remove and return up to batch_size-1
+	 * other pairs with the same base rule (that is the same rule
+	 * alias) as the selected one, which comes first. The returned
+	 * vector is empty if the set is empty.
+	 *
+	 * The additional pairs are not sampled but taken in order of
+	 * decreasing upper bound, as the point of batching is to amortize
+	 * the cost of applying a rule over many sources.
 	 */
-	std::pair<SourceRule, TruthValuePtr> thompson_select();
+	std::vector<std::pair<SourceRule, TruthValuePtr>>
+	select_batch(source_rule_selection_mode mode, int batch_size,
+	             int tournament_size=2, RandGen& rng=randGen());
 
-	// TODO: implement tournament selection as well, as a cheaper
-	// alternative to Thompson sampling.
+	/**
+	 * Remove all pairs of the sources of the given ids, meant to be
+	 * called upon eviction of these sources from the source set.
+	 *
+	 * O(m log n), where m is the number of removed pairs.
+	 */
+	void erase_sources(const std::vector<size_t>& source_ids);
 
 	/**
 	 * Return true iff the pool is empty
@@ -118,20 +164,77 @@ public:
 	 */
 	std::string to_string(const std::string& indent=empty_string) const;
 
-	// Ordered sequence of source rule pairs.
-	std::vector<SourceRule> source_rule_seq;
-
-	// Ordered sequence of Truth Values, representing the second order
-	// weights of each source rule pair. In the same order as
-	// source_rule_seq.
-	//
-	// It's easier here to have a sequence of TVs as opposed to having
-	// having weighted pairs because Thompson sampling takes in a
-	// sequence of TVs.
-	TruthValueSeq tv_seq;
+	// Probability that a beta sample exceeds its upper bound, see
+	// _bounds.
+	static const double tail_probability;
 
 private:
-	ThompsonSampling _thompson_smp;
+	friend class ::SourceRuleSetUTest;
+
+	/**
+	 * Return the slot of a pair selected according to the given
+	 * mode. The set must not be empty.
+	 */
+	size_t select_slot(source_rule_selection_mode mode,
+	                   int tournament_size, RandGen& rng) const;
+	size_t thompson_select_slot(RandGen& rng) const;
+
+	/**
+	 * Remove the pair at the given slot, O(log n).
+	 */
+	void erase(size_t slot);
+
+	/**
+	 * Remove the pair at the given slot and return it alongside its
+	 * TV.
+	 */
+	std::pair<SourceRule, TruthValuePtr> take(size_t slot);
+
+	// Pairs are stored in slots, in structure-of-arrays form. The
+	// slots of removed pairs are recycled via _free_slots.
+	std::vector<SourceRule> _source_rules;
+	TruthValueSeq _tvs;
+
+	// Alpha and beta parameters of the second order distribution of
+	// each pair, precomputed from its TV.
+	std::vector<double> _alphas;
+	std::vector<double> _betas;
+
+	// Upper bound of each beta distribution, its 1-tail_probability
+	// quantile. Pairs whose bound is below the best sample so far are
+	// not sampled during Thompson selection. This bound is not
+	// strict, but the probability of missing a better sample is at
+	// most tail_probability per skipped pair.
+	std::vector<double> _bounds;
+
+	// Mean of each beta distribution, 0 for free slots, for fitness
+	// proportionate and tournament selection.
+	SumTree _means;
+
+	// 1 for each occupied slot, 0 for free slots, for uniform and
+	// tournament selection.
+	SumTree _occupied;
+
+	// Recycled slots
+	std::vector<size_t> _free_slots;
+
+	// Slots ordered by decreasing bound
+	std::set<std::pair<double, size_t>, std::greater<std::pair<double, size_t>>> _slots_by_bound;
+
+	// Slot of each pair, to detect duplicates
+	std::map<SourceRule, size_t> _slot_index;
+
+	// Slots of the pairs of each base rule, indexed by rule alias, to
+	// build batches. Pairs of rules without alias are not indexed.
+	std::map<Handle, std::set<size_t>> _slots_by_rule;
+
+	// Slots of the pairs of each source, indexed by source id, to
+	// remove the pairs of evicted sources.
+	std::map<size_t, std::set<size_t>> _slots_by_source;
+
+	// Guard all the above, as multiple threads may populate and
+	// select at the same time.
+	mutable std::mutex _mutex;
 };
 
 std::string oc_to_string(const SourceRule& sr,
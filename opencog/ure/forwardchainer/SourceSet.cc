@@ -22,8 +22,9 @@
 
 #include "SourceSet.h"
 
-#include <boost/range/algorithm/binary_search.hpp>
-#include <boost/range/algorithm/lower_bound.hpp>
+#include <algorithm>
+
+#include <boost/range/algorithm_ext/erase.hpp>
 
 #include <opencog/util/numeric.h>
 #include <opencog/atoms/core/VariableSet.h>
@@ -35,6 +36,16 @@ bool source_ptr_less::operator()(const SourcePtr& l, const SourcePtr& r) const
 	return *l < *r;
 }
 
+size_t source_ptr_hash::operator()(const SourcePtr& src) const
+{
+	return src->get_hash();
+}
+
+bool source_ptr_equal::operator()(const SourcePtr& l, const SourcePtr& r) const
+{
+	return *l == *r;
+}
+
 double calculate_weight(const Handle& bdy, double cpx_fctr)
 {
 	// Calculate weight, for now only one fitness function is hard
@@ -56,10 +67,12 @@ double calculate_weight(const Handle& bdy, double cpx_fctr)
 Source::Source(const Handle& bdy, const Handle& vdcl, double cpx, double cpx_fctr)
 	: body(bdy),
 	  vardecl(vdcl),
+	  id(-1),
 	  complexity(cpx),
 	  complexity_factor(cpx_fctr),
 	  weight(calculate_weight(bdy, cpx_fctr)),
-	  exhausted(false)
+	  exhausted(false),
+	  _unified_rules_generation(0)
 {
 }
 
@@ -75,51 +88,56 @@ bool Source::operator<(const Source& other) const
 		or (content_eq(body, other.body) and vardecl < other.vardecl);
 }
 
+size_t Source::get_hash() const
+{
+	size_t h = body->get_hash();
+	if (vardecl)
+		h ^= vardecl->get_hash() + 0x9e3779b97f4a7c15UL + (h << 6) + (h >> 2);
+	return h;
+}
+
 bool Source::insert_rule(RulePtr rule)
 {
-	std::lock_guard<std::mutex> lock(_mutex);
+	std::unique_lock<std::shared_mutex> lock(_mutex);
 	return rules.insert(rule).second;
 }
 
 void Source::set_exhausted()
 {
-	std::lock_guard<std::mutex> lock(_mutex);
 	exhausted = true;
 }
 
 void Source::reset_exhausted()
 {
-	std::lock_guard<std::mutex> lock(_mutex);
+	std::unique_lock<std::shared_mutex> lock(_mutex);
 	exhausted = false;
 	rules.clear();
+	_exhausted_rules.clear();
 }
 
 bool Source::is_exhausted() const
 {
-	std::lock_guard<std::mutex> lock(_mutex);
 	return exhausted;
 }
 
 void Source::set_rule_exhausted(const RulePtr& rule)
 {
-	std::lock_guard<std::mutex> lock(_mutex);
+	std::unique_lock<std::shared_mutex> lock(_mutex);
 	auto it = rules.find(rule);
 	if (it != rules.end())
-		(*it)->set_exhausted();
+		_exhausted_rules.insert(*it);
 }
 
 bool Source::is_rule_exhausted(const RulePtr& rule) const
 {
-	std::lock_guard<std::mutex> lock(_mutex);
-	auto it = rules.find(rule);
+	std::shared_lock<std::shared_mutex> lock(_mutex);
 	// Note that the presence of an alpha-equivalent rule in the source
-	// is not enough to being considered exhausted, the exhausted flag
-	// of the rule must also be explicited set to true. That is in
-	// order to possibly make the distinction between a rule that is
-	// being tried and a rule that has already been tried. It's not
-	// clear though whether we need this distinction, and if we do we
-	// probably should make it explicit in the Source or Rule API.
-	return it != rules.end() and (*it)->is_exhausted();
+	// is not enough to being considered exhausted, it must also have
+	// been explicitly set exhausted. That is in order to possibly
+	// make the distinction between a rule that is being tried and a
+	// rule that has already been tried. It's not clear though whether
+	// we need this distinction.
+	return _exhausted_rules.find(rule) != _exhausted_rules.end();
 }
 
 double Source::expand_complexity(double prob) const
@@ -134,16 +152,41 @@ double Source::get_weight() const
 	return weight;
 }
 
+bool Source::get_unified_rules(const RulePtr& rule, unsigned generation,
+                               RuleSet& unified_rules) const
+{
+	std::lock_guard<std::mutex> lock(_unified_rules_mutex);
+	if (generation != _unified_rules_generation)
+		return false;
+	auto it = _unified_rules.find(rule);
+	if (it == _unified_rules.end())
+		return false;
+	unified_rules = it->second;
+	return true;
+}
+
+void Source::set_unified_rules(const RulePtr& rule, unsigned generation,
+                               const RuleSet& unified_rules) const
+{
+	std::lock_guard<std::mutex> lock(_unified_rules_mutex);
+	if (generation != _unified_rules_generation) {
+		_unified_rules.clear();
+		_unified_rules_generation = generation;
+	}
+	_unified_rules[rule] = unified_rules;
+}
+
 std::string Source::to_string(const std::string& indent) const
 {
-	std::lock_guard<std::mutex> lock(_mutex);
+	std::shared_lock<std::shared_mutex> lock(_mutex);
 	std::stringstream ss;
-	ss << indent << "body:" << std::endl
+	ss << indent << "id: " << id << std::endl
+	   << indent << "body:" << std::endl
 	   << oc_to_string(body, indent + oc_to_string_indent) << std::endl
 	   << indent << "vardecl:" << std::endl
 	   << oc_to_string(vardecl, indent + oc_to_string_indent) << std::endl
 	   << indent << "complexity: " << complexity << std::endl
-	   << indent << "exhausted: " <<  exhausted << std::endl
+	   << indent << "exhausted: " << exhausted.load() << std::endl
 	   << indent << "rules:" << std::endl
 	   << rules.to_short_string(indent + oc_to_string_indent);
 	return ss.str();
@@ -152,7 +195,7 @@ std::string Source::to_string(const std::string& indent) const
 SourceSet::SourceSet(const UREConfig& config,
                      const Handle& init_source,
                      const Handle& init_vardecl)
-	: exhausted(false), _config(config)
+	: exhausted(false), _config(config), _size(0)
 {
 	if (init_source) {
 		// Accept set of initial sources wrapped in a SetLink
@@ -161,11 +204,8 @@ SourceSet::SourceSet(const UREConfig& config,
 		if (init_sources.empty()) {
 			exhausted = true;
 		} else {
-			for (const Handle& src : init_sources) {
-				SourcePtr new_src = createSource(src, init_vardecl);
-				auto it = boost::lower_bound(sources, new_src, source_ptr_less());
-				sources.insert(it, new_src);
-			}
+			for (const Handle& src : init_sources)
+				push_back(createSource(src, init_vardecl));
 		}
 	} else {
 		exhausted = true;
@@ -174,42 +214,104 @@ SourceSet::SourceSet(const UREConfig& config,
 
 std::vector<double> SourceSet::get_weights() const
 {
-	std::lock_guard<std::mutex> lock(_mutex);
+	std::shared_lock<std::shared_mutex> lock(_mutex);
 	std::vector<double> results;
 	for (const SourcePtr& src : sources)
-		results.push_back(src->get_weight());
+		results.push_back(src ? src->get_weight() : 0.0);
+	return results;
+}
+
+std::vector<double> SourceSet::get_weights(Sources& snapshot) const
+{
+	std::shared_lock<std::shared_mutex> lock(_mutex);
+	snapshot = sources;
+	std::vector<double> results;
+	for (const SourcePtr& src : snapshot)
+		results.push_back(src ? src->get_weight() : 0.0);
 	return results;
 }
 
+SourcePtr SourceSet::select(RandGen& rng)
+{
+	while (true) {
+		// Sample under a shared lock, so that selecting threads do not
+		// serialize
+		size_t i;
+		{
+			std::shared_lock<std::shared_mutex> lock(_mutex);
+			if (_alive.total() <= 0.0)
+				return nullptr;
+			i = sample_index(rng);
+			const SourcePtr& src = sources[i];
+			if (src and not src->is_exhausted())
+				return src;
+		}
+
+		// Repair stale weight and try again. The source is checked
+		// again as another thread may have repaired or reset it in
+		// the meantime.
+		std::unique_lock<std::shared_mutex> lock(_mutex);
+		const SourcePtr& src = sources[i];
+		if (not src or src->is_exhausted()) {
+			_weights.set(i, 0.0);
+			_alive.set(i, 0.0);
+		}
+	}
+}
+
+size_t SourceSet::sample_index(RandGen& rng) const
+{
+	switch (_config.get_source_selection_mode()) {
+	case source_selection_mode::TOURNAMENT: {
+		size_t best = _alive(rng);
+		for (int k = 1; k < _config.get_tournament_size(); k++) {
+			size_t i = _alive(rng);
+			if (_weights.get(best) < _weights.get(i))
+				best = i;
+		}
+		return best;
+	}
+	case source_selection_mode::UNIFORM:
+		return _alive(rng);
+	default:
+		return _weights(rng);
+	}
+}
+
 void SourceSet::set_exhausted()
 {
-	std::lock_guard<std::mutex> lock(_mutex);
 	exhausted = true;
 }
 
 void SourceSet::reset_exhausted()
 {
-	std::lock_guard<std::mutex> lock(_mutex);
-	if (sources.empty()) {
+	std::unique_lock<std::shared_mutex> lock(_mutex);
+	if (_size == 0) {
 		exhausted = true;
 		return;
 	}
 
-	for (SourcePtr& src : sources)
-		src->reset_exhausted();
+	for (size_t i = 0; i < sources.size(); i++) {
+		if (not sources[i])
+			continue;
+		sources[i]->reset_exhausted();
+		_weights.set(i, sources[i]->get_weight());
+		_alive.set(i, 1.0);
+	}
 	exhausted = false;
 }
 
 bool SourceSet::is_exhausted() const
 {
-	std::lock_guard<std::mutex> lock(_mutex);
 	return exhausted;
 }
 
-void SourceSet::insert(const HandleSet& products, const Source& src,
-                       double prob, const std::string& msgprfx)
+SourceSet::Sources SourceSet::insert(const HandleSet& products,
+                                     const Source& src, double prob,
+                                     const std::string& msgprfx,
+                                     std::vector<size_t>* evicted)
 {
-	std::lock_guard<std::mutex> lock(_mutex);
+	std::unique_lock<std::shared_mutex> lock(_mutex);
 	const static Handle empty_variable_set = Handle(createVariableSet(HandleSeq()));
 
 	// Calculate the complexity of the new sources
@@ -222,22 +324,27 @@ void SourceSet::insert(const HandleSet& products, const Source& src,
 		SourcePtr new_src = createSource(product, empty_variable_set,
 		                                 new_cpx, new_cpx_fctr);
 
-		// Make sure it isn't already in the sources
-		if (boost::binary_search(sources, new_src, source_ptr_less())) {
+		// Insert it unless it is already in the sources, or has been
+		// evicted
+		if (is_evicted(*new_src)) {
 			LAZY_URE_LOG_FINE << msgprfx
-			                  << "The following source is already in the population: "
+			                  << "The following source has been evicted: "
 			                  << new_src->body->id_to_string();
-		} else {
+		} else if (push_back(new_src)) {
 			new_srcs.push_back(new_src);
+		} else {
+			LAZY_URE_LOG_FINE << msgprfx
+			                  << "The following source is already in the population: "
+			                  << new_src->body->id_to_string();
 		}
 	}
 
-	// Insert all new sources
-	for (SourcePtr new_src : new_srcs) {
-		// Insert it while preserving the order
-		auto it = boost::lower_bound(sources, new_src, source_ptr_less());
-		sources.insert(it, new_src);
-	}
+	// Keep the population bounded, discarding evicted new sources
+	std::vector<size_t> evicted_ids = evict();
+	boost::remove_erase_if(new_srcs, [&](const SourcePtr& new_src) {
+			return not sources[new_src->id]; });
+	if (evicted)
+		evicted->insert(evicted->end(), evicted_ids.begin(), evicted_ids.end());
 
 	// Log the new sources
 	if (ure_logger().is_debug_enabled()) {
@@ -250,23 +357,114 @@ void SourceSet::insert(const HandleSet& products, const Source& src,
 		LAZY_URE_LOG_DEBUG << msgprfx << "New sources:"
 		                    << std::endl << new_src_bodies;
 	}
+
+	return new_srcs;
+}
+
+SourceSet::Sources SourceSet::get_sources() const
+{
+	std::shared_lock<std::shared_mutex> lock(_mutex);
+	Sources alive;
+	for (const SourcePtr& src : sources)
+		if (src)
+			alive.push_back(src);
+	return alive;
+}
+
+SourcePtr SourceSet::get_source(size_t id) const
+{
+	std::shared_lock<std::shared_mutex> lock(_mutex);
+	return sources[id];
+}
+
+bool SourceSet::push_back(const SourcePtr& src)
+{
+	if (not _index.insert(src).second)
+		return false;
+	src->id = sources.size();
+	sources.push_back(src);
+	_weights.push_back(src->get_weight());
+	_alive.push_back(src->is_exhausted() ? 0.0 : 1.0);
+	_size++;
+	return true;
+}
+
+std::vector<size_t> SourceSet::evict()
+{
+	int max_sources = _config.get_max_sources();
+	if (max_sources < 0 or _size <= (size_t)max_sources)
+		return {};
+
+	// Snapshot the ranking criteria, as the weight of a source
+	// depends on its exhausted flag, which other threads may set
+	// while ranking, breaking the strict weak ordering.
+	struct Rank
+	{
+		double weight;
+		double complexity;
+		size_t id;
+	};
+	std::vector<Rank> ranks;
+	ranks.reserve(_size);
+	for (size_t i = 0; i < sources.size(); i++)
+		if (sources[i])
+			ranks.push_back({sources[i]->get_weight(),
+			                 sources[i]->complexity, i});
+
+	// Move the least promising sources to the front
+	size_t target = max_sources - max_sources / 10;
+	auto evicted_end = std::next(ranks.begin(), ranks.size() - target);
+	std::nth_element(ranks.begin(), evicted_end, ranks.end(),
+	                 [](const Rank& l, const Rank& r) {
+		                 if (l.weight != r.weight)
+			                 return l.weight < r.weight;
+		                 return r.complexity < l.complexity;
+	                 });
+
+	std::vector<size_t> ids;
+	for (auto it = ranks.begin(); it != evicted_end; ++it) {
+		ids.push_back(it->id);
+		SourcePtr& src = sources[it->id];
+		_index.erase(src);
+		_tombstones.emplace(src->get_hash(),
+		                    std::make_pair(src->body, src->vardecl));
+		_weights.set(it->id, 0.0);
+		_alive.set(it->id, 0.0);
+		src = nullptr;
+	}
+	_size = target;
+
+	LAZY_URE_LOG_DEBUG << "Evicted " << ids.size()
+	                   << " sources, " << _size << " remain";
+
+	return ids;
+}
+
+bool SourceSet::is_evicted(const Source& src) const
+{
+	auto range = _tombstones.equal_range(src.get_hash());
+	for (auto it = range.first; it != range.second; ++it)
+		if (content_eq(it->second.first, src.body) and
+		    content_eq(it->second.second, src.vardecl))
+			return true;
+	return false;
 }
 
 size_t SourceSet::size() const
 {
-	std::lock_guard<std::mutex> lock(_mutex);
-	return sources.size();
+	std::shared_lock<std::shared_mutex> lock(_mutex);
+	return _size;
 }
 
 bool SourceSet::empty() const
 {
-	std::lock_guard<std::mutex> lock(_mutex);
-	return sources.empty();
+	std::shared_lock<std::shared_mutex> lock(_mutex);
+	return _size == 0;
 }
 
 std::string SourceSet::to_string(const std::string& indent) const
 {
-	std::lock_guard<std::mutex> lock(_mutex);
+	std::shared_lock<std::shared_mutex> lock(_mutex);
 	return oc_to_string(sources, indent);
 }
 
@@ -281,8 +479,9 @@ std::string oc_to_string(const SourceSet::Sources& sources, const std::string& i
 	ss << indent << "size = " << sources.size() << std::endl;
 	size_t i = 0;
 	for (const SourcePtr& src : sources) {
-		ss << indent << "source[" << i << "]:" << std::endl
-		   << src->to_string(indent + oc_to_string_indent);
+		if (src)
+			ss << indent << "source[" << i << "]:" << std::endl
+			   << src->to_string(indent + oc_to_string_indent);
 		i++;
 	}
 	return ss.str();
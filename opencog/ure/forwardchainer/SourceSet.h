@@ -24,8 +24,13 @@
 #ifndef _OPENCOG_SOURCESET_H_
 #define _OPENCOG_SOURCESET_H_
 
+#include <atomic>
 #include <vector>
+#include <set>
+#include <unordered_map>
+#include <unordered_set>
 #include <mutex>
+#include <shared_mutex>
 
 #include <boost/operators.hpp>
 #include <boost/ptr_container/ptr_vector.hpp>
@@ -35,6 +40,7 @@
 
 #include "../Rule.h"
 #include "../UREConfig.h"
+#include "../SumTree.h"
 
 namespace opencog
 {
@@ -70,6 +76,12 @@ public:
 	bool operator==(const Source& other) const;
 	bool operator<(const Source& other) const;
 
+	/**
+	 * Hash consistent with operator==, combining the content hashes
+	 * of body and vardecl.
+	 */
+	size_t get_hash() const;
+
 	/**
 	 * Insert rule in the rule set to remember it is being
 	 * applied. Return true if insertion is successful (that is if no
@@ -93,12 +105,15 @@ public:
 	bool is_exhausted() const;
 
 	/**
-	 * Set the exhausted flag of that rule to true
+	 * Record that rule, if inserted, has been tried on that source.
+	 * The rule itself is left untouched, as it may be shared, for
+	 * instance with the cache of rule specializations.
 	 */
 	void set_rule_exhausted(const RulePtr& rule);
 
 	/**
-	 * Check if the given rule has been tried
+	 * Check if the given rule, or an alpha-equivalent one, has been
+	 * tried on that source
 	 */
 	bool is_rule_exhausted(const RulePtr& rule) const;
 
@@ -114,6 +129,24 @@ public:
 	 */
 	double get_weight() const;
 
+	/**
+	 * Memoization of the rule specializations obtained by unifying
+	 * that source with a rule, see ForwardChainer::get_valid_rules.
+	 *
+	 * get_unified_rules returns false if the specializations of that
+	 * rule are not cached for that rule set generation, otherwise
+	 * they are placed in unified_rules. The cached rules are shared,
+	 * not copied, whether they have been tried is recorded by the
+	 * source, see set_rule_exhausted.
+	 *
+	 * set_unified_rules caches them. If the generation differs from
+	 * the one of the cache, the cache is cleared first.
+	 */
+	bool get_unified_rules(const RulePtr& rule, unsigned generation,
+	                       RuleSet& unified_rules) const;
+	void set_unified_rules(const RulePtr& rule, unsigned generation,
+	                       const RuleSet& unified_rules) const;
+
 	std::string to_string(const std::string& indent=empty_string) const;
 
 	// Body of the source
@@ -122,6 +155,11 @@ public:
 	// Variable declaration, if any, associated to body
 	const Handle vardecl;
 
+	// Dense id, the index of the source in its source set, assigned
+	// on insertion. Can be used to index data about sources in
+	// vectors.
+	size_t id;
+
 	// Sum of the complexities of the steps involved in producing it.
 	const double complexity;
 
@@ -141,15 +179,25 @@ public:
 	// than 1.0.
 	const double weight;
 
-	// True iff all rules that could expand the source have been tried
-	bool exhausted;
+	// True iff all rules that could expand the source have been
+	// tried. Atomic so that weights can be read without locking.
+	std::atomic<bool> exhausted;
 
 	// Rules so far attempted on that source. Primary owner.
 	RuleSet rules;
 
 private:
-	// TODO: subdivide in smaller and shared mutexes
-	mutable std::mutex _mutex;
+	// Subset of rules that have been tried, as opposed to being tried
+	RuleSet _exhausted_rules;
+
+	// Guard rules and _exhausted_rules
+	mutable std::shared_mutex _mutex;
+
+	// Cache of rule specializations, keyed by base rule, valid for
+	// rule set generation _unified_rules_generation.
+	mutable std::unordered_map<RulePtr, RuleSet> _unified_rules;
+	mutable unsigned _unified_rules_generation;
+	mutable std::mutex _unified_rules_mutex;
 };
 
 typedef std::shared_ptr<Source> SourcePtr;
@@ -158,9 +206,22 @@ struct source_ptr_less
 {
 	bool operator()(const SourcePtr& l, const SourcePtr& r) const;
 };
+struct source_ptr_hash
+{
+	size_t operator()(const SourcePtr& src) const;
+};
+struct source_ptr_equal
+{
+	bool operator()(const SourcePtr& l, const SourcePtr& r) const;
+};
 
 /**
  * Population of sources to forwardly expand. Primary owner.
+ *
+ * If the maximum number of sources is set, the least promising
+ * sources are evicted when it is exceeded. An evicted source leaves
+ * its slot empty, so that ids remain valid, and a tombstone, its body
+ * and variable declaration, so that it is not reinserted.
  */
 // TODO: this class has things in common with BIT, maybe their common
 // things could be placed in a parent class.
@@ -177,6 +238,27 @@ public:
 	 */
 	std::vector<double> get_weights() const;
 
+	/**
+	 * Like get_weights, but also copy the sources in snapshot, in the
+	 * same order as the weights. Useful for logging while other
+	 * threads may be inserting new ones.
+	 */
+	std::vector<double> get_weights(std::vector<SourcePtr>& snapshot) const;
+
+	/**
+	 * Select a source according to the source selection mode of the
+	 * configuration, in O(log n), or O(k log n) for tournament
+	 * selection of size k. Return nullptr if all sources are
+	 * exhausted.
+	 *
+	 * Sources may be set exhausted directly, without informing the
+	 * source set, so their weights in the sum tree may be
+	 * stale. These are repaired lazily, whenever an exhausted source
+	 * is sampled its weight is set to zero and sampling is retried.
+	 * Sampling only takes a shared lock, repairs an exclusive one.
+	 */
+	SourcePtr select(RandGen& rng=randGen());
+
 	/**
 	 * Set exhausted flag to true
 	 */
@@ -196,32 +278,104 @@ public:
 	/**
 	 * Insert produced sources from src into the population, by
 	 * applying rule with a given probability of success prob (useful
-	 * for calculating complexity).
+	 * for calculating complexity). Return the sources that were not
+	 * already in the population, nor evicted from it, and that have
+	 * survived eviction.
+	 *
+	 * If evicted is provided, the ids of the sources evicted by that
+	 * insertion are appended to it, so that the caller can discard
+	 * whatever refers to them.
+	 */
+	std::vector<SourcePtr> insert(const HandleSet& products, const Source& src,
+	                              double prob, const std::string& msgprfx="",
+	                              std::vector<size_t>* evicted=nullptr);
+
+	/**
+	 * Return a copy of the sources, safe to iterate over while other
+	 * threads insert new ones. Evicted sources are excluded.
+	 */
+	std::vector<SourcePtr> get_sources() const;
+
+	/**
+	 * Return the source of the given id, nullptr if it has been
+	 * evicted.
 	 */
-	void insert(const HandleSet& products, const Source& src,
-	            double prob, const std::string& msgprfx="");
+	SourcePtr get_source(size_t id) const;
 
+	/**
+	 * Number of sources, excluding evicted ones.
+	 */
 	size_t size() const;
 
 	bool empty() const;
 
 	std::string to_string(const std::string& indent=empty_string) const;
 
-	// Collection of sources. We use a sorted vector instead of a set
-	// because the source being expanded is modified (it keeps track of
-	// its expansion rules). Alternatively we could use a set and
-	// define Sources::rules as mutable.
+	// Collection of sources, in order of insertion, thus indexed by
+	// id. The weight of sources[i] is at index i of _weights. Evicted
+	// sources are replaced by nullptr.
 	typedef std::vector<SourcePtr> Sources;
 	Sources sources;
 
 	// True iff all sources have been tried
-	bool exhausted;
+	std::atomic<bool> exhausted;
 
 private:
+	/**
+	 * Append a source if not already in, return true iff it was
+	 * inserted.
+	 */
+	bool push_back(const SourcePtr& src);
+
+	/**
+	 * If the maximum number of sources is exceeded, evict the least
+	 * promising sources, that is the exhausted ones first, then the
+	 * ones with the lowest weights, then the most complex ones.
+	 *
+	 * In order to amortize the cost of ranking the sources, 10% of
+	 * the maximum are evicted beyond what is necessary.
+	 *
+	 * Return the ids of the evicted sources.
+	 */
+	std::vector<size_t> evict();
+
+	/**
+	 * Return true iff the given source has been evicted.
+	 */
+	bool is_evicted(const Source& src) const;
+
+	/**
+	 * Sample the index of a source according to the source selection
+	 * mode. May return the index of an exhausted source whose weight
+	 * has not been repaired yet.
+	 */
+	size_t sample_index(RandGen& rng) const;
+
 	const UREConfig& _config;
 
-	// TODO: subdivide in smaller and shared mutexes
-	mutable std::mutex _mutex;
+	// Weights of the sources, for O(log n) sampling
+	SumTree _weights;
+
+	// 1 for each source that is not exhausted, 0 otherwise, for
+	// O(log n) uniform sampling
+	SumTree _alive;
+
+	// Index of sources by content hash, to detect duplicates in
+	// O(1). Contents are only compared on hash collisions.
+	std::unordered_set<SourcePtr, source_ptr_hash, source_ptr_equal> _index;
+
+	// Bodies and variable declarations of the evicted sources,
+	// indexed by content hash. Contents are only compared on hash
+	// hits, rather than keeping the evicted sources themselves.
+	std::unordered_multimap<size_t, std::pair<Handle, Handle>> _tombstones;
+
+	// Number of sources, excluding evicted ones
+	size_t _size;
+
+	// Guard sources. Readers (selection, weights, size, etc) take a
+	// shared lock, insertion, reset and weight repairs take an
+	// exclusive lock.
+	mutable std::shared_mutex _mutex;
 };
 
 std::string oc_to_string(const Source& source,